@@ -37,6 +37,8 @@ startproject "lui-tool"
 include "src/tool.lua"
 include "src/utils.lua"
 include "src/IW6.lua"
+include "src/bench.lua"
 tool:project()
 utils:project()
 IW6:project()
+bench:project()
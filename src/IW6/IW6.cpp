@@ -5,102 +5,255 @@
 
 #include "IW6.hpp"
 
+// the avx2 scan is built for every x86 target and picked at run time, so
+// default builds use it on cpus that have it
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define LUI_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LUI_TARGET_AVX2
+#else
+#define LUI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
 namespace IW6
 {
 
-std::unordered_map<opcode, std::string> opcode_map
+struct opcode_name_entry
 {
-    { opcode::HKS_OPCODE_GETFIELD, "GETFIELD" },
-    { opcode::HKS_OPCODE_TEST, "TEST" },
-    { opcode::HKS_OPCODE_CALL_I, "CALL_I" },
-    { opcode::HKS_OPCODE_EQ, "EQ" },
-    { opcode::HKS_OPCODE_EQ_BK, "EQ_BK" },
-    { opcode::HKS_OPCODE_GETGLOBAL, "GETGLOBAL" },
-    { opcode::HKS_OPCODE_MOVE, "MOVE" },
-    { opcode::HKS_OPCODE_SELF, "SELF" },
-    { opcode::HKS_OPCODE_RETURN, "RETURN" },
-    { opcode::HKS_OPCODE_GETTABLE_S, "GETTABLE_S" },
-    { opcode::HKS_OPCODE_GETTABLE, "GETTABLE" },
-    { opcode::HKS_OPCODE_LOADBOOL, "LOADBOOL" },
-    { opcode::HKS_OPCODE_TFORLOOP, "TFORLOOP" },
-    { opcode::HKS_OPCODE_SETFIELD, "SETFIELD" },
-    { opcode::HKS_OPCODE_SETTABLE_S, "SETTABLE_S" },
-    { opcode::HKS_OPCODE_SETTABLE_S_BK, "SETTABLE_S_BK" },
-    { opcode::HKS_OPCODE_SETTABLE, "SETTABLE" },
-    { opcode::HKS_OPCODE_SETTABLE_BK, "SETTABLE_BK" },
-    { opcode::HKS_OPCODE_TAILCALL_I, "TAILCALL_I" },
-    { opcode::HKS_OPCODE_LOADK, "LOADK" },
-    { opcode::HKS_OPCODE_LOADNIL, "LOADNIL" },
-    { opcode::HKS_OPCODE_SETGLOBAL, "SETGLOBAL" },
-    { opcode::HKS_OPCODE_JMP, "JMP" },
-    { opcode::HKS_OPCODE_CALL, "CALL" },
-    { opcode::HKS_OPCODE_TAILCALL, "TAILCALL" },
-    { opcode::HKS_OPCODE_GETUPVAL, "GETUPVAL" },
-    { opcode::HKS_OPCODE_SETUPVAL, "SETUPVAL" },
-    { opcode::HKS_OPCODE_ADD, "ADD" },
-    { opcode::HKS_OPCODE_ADD_BK, "ADD_BK" },
-    { opcode::HKS_OPCODE_SUB, "SUB" },
-    { opcode::HKS_OPCODE_SUB_BK, "SUB_BK" },
-    { opcode::HKS_OPCODE_MUL, "MUL" },
-    { opcode::HKS_OPCODE_MUL_BK, "MUL_BK" },
-    { opcode::HKS_OPCODE_DIV, "DIV" },
-    { opcode::HKS_OPCODE_DIV_BK, "DIV_BK" },
-    { opcode::HKS_OPCODE_MOD, "MOD" },
-    { opcode::HKS_OPCODE_MOD_BK, "MOD_BK" },
-    { opcode::HKS_OPCODE_POW, "POW" },
-    { opcode::HKS_OPCODE_POW_BK, "POW_BK" },
-    { opcode::HKS_OPCODE_NEWTABLE, "NEWTABLE" },
-    { opcode::HKS_OPCODE_UNM, "UNM" },
-    { opcode::HKS_OPCODE_NOT, "NOT" },
-    { opcode::HKS_OPCODE_LEN, "LEN" },
-    { opcode::HKS_OPCODE_LT, "LT" },
-    { opcode::HKS_OPCODE_LT_BK, "LT_BK" },
-    { opcode::HKS_OPCODE_LE, "LE" },
-    { opcode::HKS_OPCODE_LE_BK, "LE_BK" },
-    { opcode::HKS_OPCODE_CONCAT, "CONCAT" },
-    { opcode::HKS_OPCODE_TESTSET, "TESTSET" },
-    { opcode::HKS_OPCODE_FORPREP, "FORPREP" },
-    { opcode::HKS_OPCODE_FORLOOP, "FORLOOP" },
-    { opcode::HKS_OPCODE_SETLIST, "SETLIST" },
-    { opcode::HKS_OPCODE_CLOSE, "CLOSE" },
-    { opcode::HKS_OPCODE_CLOSURE, "CLOSURE" },
-    { opcode::HKS_OPCODE_VARARG, "VARARG" },
-    { opcode::HKS_OPCODE_TAILCALL_I_R1, "TAILCALL_I_R1" },
-    { opcode::HKS_OPCODE_CALL_I_R1, "CALL_I_R1" },
-    { opcode::HKS_OPCODE_SETUPVAL_R1, "SETUPVAL_R1" },
-    { opcode::HKS_OPCODE_TEST_R1, "TEST_R1" },
-    { opcode::HKS_OPCODE_NOT_R1, "NOT_R1" },
-    { opcode::HKS_OPCODE_GETFIELD_R1, "GETFIELD_R1" },
-    { opcode::HKS_OPCODE_SETFIELD_R1, "SETFIELD_R1" },
-    { opcode::HKS_OPCODE_DATA, "DATA" },
-    { opcode::HKS_OPCODE_GETGLOBAL_MEM, "GETGLOBAL_MEM" },
+    std::string_view name;
+    opcode id;
 };
 
-auto opcode_id(const std::string& name) -> opcode
+constexpr auto count_opcodes() -> std::size_t
+{
+    std::size_t count = 0;
+
+    for (auto& info : opcode_table)
+    {
+        if (!info.name.empty()) count++;
+    }
+
+    return count;
+}
+
+// opcode names sorted at compile time for binary search
+constexpr auto make_opcode_names() -> std::array<opcode_name_entry, count_opcodes()>
 {
-    for (auto& opcode : opcode_map)
+    std::array<opcode_name_entry, count_opcodes()> names {};
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < opcode_table.size(); i++)
     {
-        if (opcode.second == name)
+        if (opcode_table[i].name.empty()) continue;
+
+        auto entry = opcode_name_entry { opcode_table[i].name, opcode(i) };
+        auto pos = count++;
+
+        for (; pos > 0 && entry.name < names[pos - 1].name; pos--)
         {
-            return opcode.first;
+            names[pos] = names[pos - 1];
         }
+
+        names[pos] = entry;
     }
 
-    LOG_ERROR("Couldn't resolve opcode id for name '%s'!", name.data());
-    return opcode::HKS_OPCODE_MAX;
+    return names;
 }
 
-auto opcode_name(opcode id) -> std::string
+constexpr auto opcode_names = make_opcode_names();
+
+auto opcode_id(std::string_view name) -> opcode
 {
-    const auto itr = opcode_map.find(id);
+    const auto itr = std::lower_bound(opcode_names.begin(), opcode_names.end(), name,
+        [](const opcode_name_entry& entry, std::string_view name) { return entry.name < name; });
 
-    if (itr != opcode_map.end())
+    if (itr != opcode_names.end() && itr->name == name)
     {
-        return itr->second;
+        return itr->id;
+    }
+
+    return opcode::HKS_OPCODE_MAX;
+}
+
+auto opcode_name(opcode id) -> std::string_view
+{
+    if (opcode_valid(std::uint8_t(id)))
+    {
+        return opcode_table[std::size_t(id)].name;
     }
 
-    LOG_ERROR("Couldn't resolve opcode name for id '0x%hhX'!", id);
     return "";
 }
 
+// one bit per 7-bit opcode value, byte n holds opcodes 8n to 8n+7
+constexpr auto make_opcode_bitmap() -> std::array<std::uint8_t, 16>
+{
+    std::array<std::uint8_t, 16> bitmap {};
+
+    for (std::size_t i = 0; i < opcode_count; i++)
+    {
+        if (opcode_valid(std::uint8_t(i))) bitmap[i >> 3] |= std::uint8_t(1 << (i & 7));
+    }
+
+    return bitmap;
+}
+
+#if defined(LUI_AVX2)
+auto has_avx2() -> bool
+{
+#if defined(__AVX2__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // the os must save the ymm registers too
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// 32 words per step: opcodes are narrowed to bytes and tested against the
+// bitmap with two nibble lookups, the lane order shuffled by the packs does
+// not matter because a failing block is rescanned in order
+LUI_TARGET_AVX2 auto find_invalid_opcode_avx2(const std::uint32_t* code, std::size_t count) -> std::size_t
+{
+    static constexpr auto bitmap = make_opcode_bitmap();
+
+    const auto table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bitmap.data())));
+    const auto bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    const auto low3 = _mm256_set1_epi8(0x07);
+    const auto low4 = _mm256_set1_epi8(0x0F);
+    const auto zero = _mm256_setzero_si256();
+
+    std::size_t i = 0;
+
+    for (; i + 32 <= count; i += 32)
+    {
+        auto ptr = reinterpret_cast<const __m256i*>(code + i);
+        auto a = _mm256_srli_epi32(_mm256_loadu_si256(ptr + 0), POS_OP);
+        auto b = _mm256_srli_epi32(_mm256_loadu_si256(ptr + 1), POS_OP);
+        auto c = _mm256_srli_epi32(_mm256_loadu_si256(ptr + 2), POS_OP);
+        auto d = _mm256_srli_epi32(_mm256_loadu_si256(ptr + 3), POS_OP);
+        auto ops = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+
+        auto group = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(ops, 3), low4));
+        auto bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(ops, low3));
+        auto invalid = _mm256_cmpeq_epi8(_mm256_and_si256(group, bit), zero);
+
+        if (_mm256_movemask_epi8(invalid) != 0) break;
+    }
+
+    for (; i < count; i++)
+    {
+        if (!opcode_valid(std::uint8_t(code[i] >> POS_OP))) return i;
+    }
+
+    return count;
+}
+#endif
+
+// index of the first word with an unknown opcode, count when all are valid
+auto find_invalid_opcode(const std::uint32_t* code, std::size_t count) -> std::size_t
+{
+#if defined(LUI_AVX2)
+    static const auto avx2 = has_avx2();
+
+    if (avx2) return find_invalid_opcode_avx2(code, count);
+#endif
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!opcode_valid(std::uint8_t(code[i] >> POS_OP))) return i;
+    }
+
+    return count;
+}
+
+auto decode_instruction(std::uint32_t index, std::uint32_t value) -> lui::instruction
+{
+    auto OP = (std::uint8_t)((value & MASK_OP) >> POS_OP);
+    auto A  = (std::int32_t)((value & MASK_A) >> POS_A);
+    auto C  = (std::int32_t)((value & MASK_C) >> POS_C);
+    auto B  = (std::int32_t)((value & MASK_B) >> POS_B);
+    auto Bx = (std::int32_t)((value & MASK_Bx) >> POS_Bx);
+    auto sBx = (std::int32_t)(Bx - 0x10000 + 1);
+    bool sZero = false;
+    if (C >= 0x100) { C -= 0x100; sZero = true; }
+
+    return lui::instruction(index, value, OP, A, B, C, Bx, sBx, sZero);
+}
+
+auto decode_instruction(const lui::function& func, std::uint32_t index) -> lui::instruction
+{
+    return decode_instruction(func.code_offset + index * 4, func.code.at(index));
+}
+
+// header written by the game's compiler, used when the listing doesn't carry one
+auto default_header() -> lui::header
+{
+    lui::header header;
+
+    header.magic = 0x61754C1B;
+    header.lua_version = 0x51;
+    header.format_version = 0xD;
+    header.endianness = 0x1;
+    header.size_of_int = 0x4;
+    header.size_of_size_t = 0x8;
+    header.size_of_intruction = 0x4;
+    header.size_of_lua_number = 0x4;
+    header.integral_flag = 0x0;
+    header.build_flags = 0x3;
+    header.referenced_mode = 0x0;
+    header.types = {
+        {0, "TNIL"},
+        {1, "TBOOLEAN"},
+        {2, "TLIGHTUSERDATA"},
+        {3, "TNUMBER"},
+        {4, "TSTRING"},
+        {5, "TTABLE"},
+        {6, "TFUNCTION"},
+        {7, "TUSERDATA"},
+        {8, "TTHREAD"},
+        {9, "TIFUNCTION"},
+        {10, "TCFUNCTION"},
+        {11, "TUI64"},
+        {12, "TSTRUCT"},
+    };
+    header.type_count = header.types.size();
+
+    return header;
+}
+
+// whether data starts with the header default_header describes. the fixed
+// fields after the signature tell a real chunk from the same four bytes
+// turning up inside another one
+auto is_chunk(const std::uint8_t* data, std::size_t size) -> bool
+{
+    static const auto header = default_header();
+
+    const std::uint8_t fields[] = {
+        header.lua_version, header.format_version, header.endianness, header.size_of_int,
+        header.size_of_size_t, header.size_of_intruction, header.size_of_lua_number,
+        header.integral_flag, header.build_flags, header.referenced_mode,
+    };
+
+    if (size < sizeof(header.magic) + sizeof(fields)) return false;
+
+    return std::memcmp(data, &header.magic, sizeof(header.magic)) == 0 &&
+        std::memcmp(data + sizeof(header.magic), fields, sizeof(fields)) == 0;
+}
+
 } // namespace IW6
@@ -10,6 +10,8 @@
 
 #include "assembler.hpp"
 #include "disassembler.hpp"
+#include "cfg.hpp"
+#include "liveness.hpp"
 #include "decompiler.hpp"
 
 namespace IW6
@@ -152,8 +154,128 @@ enum class opcode : std::uint8_t
     HKS_OPCODE_MAX = 0x5E,
 };
 
-auto opcode_id(const std::string& name) -> opcode;
-auto opcode_name(opcode id) -> std::string;
+enum class opmode : std::uint8_t
+{
+    ABC,
+    ABx,
+    AsBx,
+};
+
+enum class oparg : std::uint8_t
+{
+    N,      // not used
+    U,      // plain value (count, flag, index)
+    R,      // register
+    K,      // constant
+    RK,     // register, or constant when the sZero bit is set
+    UPVAL,  // upvalue
+    J,      // jump offset
+};
+
+struct opcode_info
+{
+    std::string_view name;
+    opmode mode;
+    oparg A;
+    oparg B;    // Bx or sBx in ABx/AsBx mode
+    oparg C;
+};
+
+constexpr auto opcode_count = static_cast<std::size_t>(opcode::HKS_OPCODE_MAX);
+
+constexpr auto make_opcode_table() -> std::array<opcode_info, opcode_count>
+{
+    std::array<opcode_info, opcode_count> table {};
+
+#define OPCODE_INFO(id, mode, a, b, c) \
+    table[std::size_t(opcode::HKS_OPCODE_##id)] = { #id, opmode::mode, oparg::a, oparg::b, oparg::c }
+
+    OPCODE_INFO(GETFIELD,       ABC,  R, R,     K);
+    OPCODE_INFO(TEST,           ABC,  R, N,     U);
+    OPCODE_INFO(CALL_I,         ABC,  R, U,     U);
+    OPCODE_INFO(EQ,             ABC,  U, R,     RK);
+    OPCODE_INFO(EQ_BK,          ABC,  U, K,     R);
+    OPCODE_INFO(GETGLOBAL,      ABx,  R, K,     N);
+    OPCODE_INFO(MOVE,           ABC,  R, R,     N);
+    OPCODE_INFO(SELF,           ABC,  R, R,     RK);
+    OPCODE_INFO(RETURN,         ABC,  R, U,     N);
+    OPCODE_INFO(GETTABLE_S,     ABC,  R, R,     RK);
+    OPCODE_INFO(GETTABLE,       ABC,  R, R,     RK);
+    OPCODE_INFO(LOADBOOL,       ABC,  R, U,     U);
+    OPCODE_INFO(TFORLOOP,       ABC,  R, N,     U);
+    OPCODE_INFO(SETFIELD,       ABC,  R, K,     RK);
+    OPCODE_INFO(SETTABLE_S,     ABC,  R, R,     RK);
+    OPCODE_INFO(SETTABLE_S_BK,  ABC,  R, K,     RK);
+    OPCODE_INFO(SETTABLE,       ABC,  R, R,     RK);
+    OPCODE_INFO(SETTABLE_BK,    ABC,  R, K,     RK);
+    OPCODE_INFO(TAILCALL_I,     ABC,  R, U,     N);
+    OPCODE_INFO(LOADK,          ABx,  R, K,     N);
+    OPCODE_INFO(LOADNIL,        ABC,  R, R,     N);
+    OPCODE_INFO(SETGLOBAL,      ABx,  R, K,     N);
+    OPCODE_INFO(JMP,            AsBx, N, J,     N);
+    OPCODE_INFO(CALL,           ABC,  R, U,     U);
+    OPCODE_INFO(TAILCALL,       ABC,  R, U,     N);
+    OPCODE_INFO(GETUPVAL,       ABC,  R, UPVAL, N);
+    OPCODE_INFO(SETUPVAL,       ABC,  R, UPVAL, N);
+    OPCODE_INFO(ADD,            ABC,  R, R,     RK);
+    OPCODE_INFO(ADD_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(SUB,            ABC,  R, R,     RK);
+    OPCODE_INFO(SUB_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(MUL,            ABC,  R, R,     RK);
+    OPCODE_INFO(MUL_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(DIV,            ABC,  R, R,     RK);
+    OPCODE_INFO(DIV_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(MOD,            ABC,  R, R,     RK);
+    OPCODE_INFO(MOD_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(POW,            ABC,  R, R,     RK);
+    OPCODE_INFO(POW_BK,         ABC,  R, K,     R);
+    OPCODE_INFO(NEWTABLE,       ABC,  R, U,     U);
+    OPCODE_INFO(UNM,            ABC,  R, R,     N);
+    OPCODE_INFO(NOT,            ABC,  R, R,     N);
+    OPCODE_INFO(LEN,            ABC,  R, R,     N);
+    OPCODE_INFO(LT,             ABC,  U, R,     RK);
+    OPCODE_INFO(LT_BK,          ABC,  U, K,     R);
+    OPCODE_INFO(LE,             ABC,  U, R,     RK);
+    OPCODE_INFO(LE_BK,          ABC,  U, K,     R);
+    OPCODE_INFO(CONCAT,         ABC,  R, R,     R);
+    OPCODE_INFO(TESTSET,        ABC,  R, R,     U);
+    OPCODE_INFO(FORPREP,        AsBx, R, J,     N);
+    OPCODE_INFO(FORLOOP,        AsBx, R, J,     N);
+    OPCODE_INFO(SETLIST,        ABC,  R, U,     U);
+    OPCODE_INFO(CLOSE,          ABC,  R, N,     N);
+    OPCODE_INFO(CLOSURE,        ABx,  R, U,     N);
+    OPCODE_INFO(VARARG,         ABC,  R, U,     N);
+    OPCODE_INFO(TAILCALL_I_R1,  ABC,  R, U,     N);
+    OPCODE_INFO(CALL_I_R1,      ABC,  R, U,     U);
+    OPCODE_INFO(SETUPVAL_R1,    ABC,  R, UPVAL, N);
+    OPCODE_INFO(TEST_R1,        ABC,  R, N,     U);
+    OPCODE_INFO(NOT_R1,         ABC,  R, R,     N);
+    OPCODE_INFO(GETFIELD_R1,    ABC,  R, R,     K);
+    OPCODE_INFO(SETFIELD_R1,    ABC,  R, K,     RK);
+    OPCODE_INFO(DATA,           ABx,  U, U,     N);
+    OPCODE_INFO(GETGLOBAL_MEM,  ABx,  R, K,     N);
+
+#undef OPCODE_INFO
+
+    return table;
+}
+
+// indexed by opcode value, unsupported opcodes have an empty name
+inline constexpr auto opcode_table = make_opcode_table();
+
+constexpr auto opcode_valid(std::uint8_t id) -> bool
+{
+    return id < opcode_count && !opcode_table[id].name.empty();
+}
+
+auto find_invalid_opcode(const std::uint32_t* code, std::size_t count) -> std::size_t;
+// HKS_OPCODE_MAX for a name the game doesn't have, empty for such an id
+auto opcode_id(std::string_view name) -> opcode;
+auto opcode_name(opcode id) -> std::string_view;
+auto decode_instruction(std::uint32_t index, std::uint32_t value) -> lui::instruction;
+auto decode_instruction(const lui::function& func, std::uint32_t index) -> lui::instruction;
+auto default_header() -> lui::header;
+auto is_chunk(const std::uint8_t* data, std::size_t size) -> bool;
 
 } // namespace IW6
 
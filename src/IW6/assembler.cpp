@@ -10,59 +10,63 @@ namespace IW6
 
 auto assembler::output() -> std::vector<std::uint8_t>
 {
-    std::vector<std::uint8_t> output;
+    if (output_ == nullptr) return {};
 
-    output.resize(output_->pos());
-    std::memcpy(output.data(), output_->buffer().data(), output.size());
-
-    return output;
+    return output_->release();
 }
 
 void assembler::assemble(std::vector<std::uint8_t>& data)
 {
-    // TODO: make the text parser
+    auto text = std::string_view(reinterpret_cast<const char*>(data.data()), data.size());
+
+    this->assemble(this->parse(text));
 }
 
 void assembler::assemble(lui::file_ptr data)
 {
-    output_ = std::make_unique<utils::byte_buffer>(0x1000000);
-    assemble_header();
+    output_ = std::make_unique<utils::byte_buffer>(0x1000);
+    layout_.clear();
+    assemble_header(data->header);
     assemble_function(data->main);
-    assemble_prototype();
-}
-
-void assembler::assemble_header()
-{
-    output_->write<std::uint32_t>(0x61754C1B); // signature
-    output_->write<std::uint8_t>(0x51);     // lua_version
-    output_->write<std::uint8_t>(0xD);      // format_version
-    output_->write<std::uint8_t>(0x1);      // endianness
-    output_->write<std::uint8_t>(0x4);      // size_of_int
-    output_->write<std::uint8_t>(0x8);      // size_of_size_t
-    output_->write<std::uint8_t>(0x4);      // size_of_intruction
-    output_->write<std::uint8_t>(0x4);      // size_of_lua_number
-    output_->write<std::uint8_t>(0x00);     // integral_flag
-    output_->write<std::uint8_t>(0x03);     // build_flags
-    output_->write<std::uint8_t>(0x00);     // referenced_mode
-    output_->write<std::uint32_t>(0x0D);    // type_count
-
-    static std::vector<lui::type_info> types = {
-        {0, "TNIL"},
-        {1, "TBOOLEAN"},
-        {2, "TLIGHTUSERDATA"},
-        {3, "TNUMBER"},
-        {4, "TSTRING"},
-        {5, "TTABLE"},
-        {6, "TFUNCTION"},
-        {7, "TUSERDATA"},
-        {8, "TTHREAD"},
-        {9, "TIFUNCTION"},
-        {10, "TCFUNCTION"},
-        {11, "TUI64"},
-        {12, "TSTRUCT"},
-    };
-
-    for(auto type : types)
+    assemble_prototype(data->prototype);
+}
+
+auto assembler::locate(std::size_t offset) -> std::string
+{
+    auto itr = std::upper_bound(layout_.begin(), layout_.end(), offset, [](std::size_t offset, const section& sect)
+    {
+        return offset < sect.offset;
+    });
+
+    if (itr == layout_.begin()) return "header";
+
+    auto& sect = *(--itr);
+
+    if (sect.instructions < 0) return sect.name;
+
+    auto inst = (offset - sect.offset) / 4;
+
+    if (inst >= std::size_t(sect.instructions)) return sect.name + ", constants";
+
+    return utils::string::va("%s, instruction %zu", sect.name.data(), inst);
+}
+
+void assembler::assemble_header(const lui::header& header)
+{
+    output_->write<std::uint32_t>(header.magic);
+    output_->write<std::uint8_t>(header.lua_version);
+    output_->write<std::uint8_t>(header.format_version);
+    output_->write<std::uint8_t>(header.endianness);
+    output_->write<std::uint8_t>(header.size_of_int);
+    output_->write<std::uint8_t>(header.size_of_size_t);
+    output_->write<std::uint8_t>(header.size_of_intruction);
+    output_->write<std::uint8_t>(header.size_of_lua_number);
+    output_->write<std::uint8_t>(header.integral_flag);
+    output_->write<std::uint8_t>(header.build_flags);
+    output_->write<std::uint8_t>(header.referenced_mode);
+    output_->write<std::uint32_t>(header.types.size());
+
+    for(const auto& type : header.types)
     {
         output_->write<std::uint32_t>(type.id);
         output_->write<std::uint32_t>(type.name.size() + 1);
@@ -72,6 +76,8 @@ void assembler::assemble_header()
 
 void assembler::assemble_function(const lui::function& func)
 {
+    layout_.push_back({ output_->pos(), func.name, -1 });
+
     output_->write<std::uint32_t>(func.upval_count); //upvals
     output_->write<std::uint32_t>(func.param_count); // params
     output_->write<std::uint8_t>(func.vararg_flags);  // varargs
@@ -86,24 +92,26 @@ void assembler::assemble_function(const lui::function& func)
             output_->write<std::uint8_t>(0x5F);
     }
 
-    // instructions
-    for(auto i = 0; i < func.instruction_count; i++)
+    // instructions, constants up to the next section
+    layout_.push_back({ output_->pos(), func.name, std::int64_t(func.instruction_count) });
+
+    for(auto i = 0u; i < func.instruction_count; i++)
     {
-        output_->write<std::uint32_t>(func.instructions.at(i)->value);
+        output_->write<std::uint32_t>(func.code.at(i));
     }
 
     output_->write<std::uint32_t>(func.constant_count); // constants
 
-    for(auto i = 0; i < func.constant_count; i++)
+    for(auto i = 0u; i < func.constant_count; i++)
     {
         assemble_constant(func, i);
     }
 
-    output_->write<std::uint32_t>(0); // debug
+    output_->write<std::uint32_t>(func.debug); // debug
 
     output_->write<std::uint32_t>(func.sub_func_count); // sub_funcs
 
-    for(auto i = 0; i < func.sub_func_count; i++)
+    for(auto i = 0u; i < func.sub_func_count; i++)
     {
         assemble_function(func.sub_funcs.at(i));
     }
@@ -111,26 +119,26 @@ void assembler::assemble_function(const lui::function& func)
 
 void assembler::assemble_constant(const lui::function& func, std::uint32_t index)
 {
-    auto kst = func.constants.at(index);
+    const auto& kst = func.constants.at(index);
 
-    output_->write<std::uint8_t>(std::uint8_t(kst.data_.type_));
+    output_->write<std::uint8_t>(std::uint8_t(kst.type_));
 
-    switch(kst.data_.type_)
+    switch(kst.type_)
     {
         case lui::data::t::NIL:
         break;
         case lui::data::t::BOOLEAN:
-            output_->write<std::uint8_t>((kst.data_.value_ == "true") ? 1 : 0);
+            output_->write<std::uint8_t>(kst.boolean_ ? 1 : 0);
         break;
         /*case lui::data::t::LIGHTUSERDATA:
             value = utils::string::va("%lld", buffer_->read<std::uint64_t>());
         break;*/
         case lui::data::t::NUMBER:
-            output_->write<float>(std::stof(kst.data_.value_));
+            output_->write<float>(kst.number_);
         break;
         case lui::data::t::STRING:
-            output_->write<std::uint64_t>(kst.data_.value_.size() + 1);
-            output_->write_c_string(kst.data_.value_);
+            output_->write<std::uint64_t>(kst.string_.size() + 1);
+            output_->write_c_string(kst.string_);
         break;
         default:
             DISASSEMBLER_ERROR("UNKNOWN CONSTANT TYPE");
@@ -138,16 +146,417 @@ void assembler::assemble_constant(const lui::function& func, std::uint32_t index
     }
 }
 
-void assembler::assemble_prototype()
+void assembler::assemble_prototype(const lui::prototype& proto)
 {
-    output_->write<std::uint32_t>(1);
-    output_->write<std::uint32_t>(0);
-    output_->write<std::uint32_t>(0);
+    layout_.push_back({ output_->pos(), "prototype", -1 });
+
+    output_->write<std::uint32_t>(proto.head_mismatch);
+    output_->write<std::uint32_t>(proto.unk1);
+    output_->write<std::uint32_t>(proto.unk2);
 }
 
-void assembler::assemble_instruction()
+auto assembler::parse(std::string_view data) -> lui::file_ptr
 {
-    // TODO: convert instruction fields and glue int32 value.
+    auto file = std::make_unique<lui::file>();
+    auto has_main = false;
+
+    file->header = default_header();
+    file->prototype = { 1, 0, 0 };
+    file->strings = std::make_shared<utils::string_pool>();
+    strings_ = file->strings.get();
+
+    scopes_.clear();
+    line_ = 0;
+
+    while (!data.empty())
+    {
+        auto end = data.find('\n');
+        auto line = utils::string::trim(data.substr(0, end));
+        data = (end == std::string_view::npos) ? std::string_view() : data.substr(end + 1);
+        line_++;
+
+        if (line.empty()) continue;
+
+        if (utils::string::starts_with(line, "sub_"))
+        {
+            if (scopes_.empty() && has_main)
+            {
+                ASSEMBLER_ERROR("line %zu: more than one main function", line_);
+            }
+
+            has_main = true;
+            this->parse_function(*file, line);
+        }
+        else if (scopes_.empty())
+        {
+            ASSEMBLER_ERROR("line %zu: statement outside of a function", line_);
+        }
+        else if (utils::string::starts_with(line, "end_"))
+        {
+            this->parse_function_end();
+        }
+        else if (utils::string::starts_with(line, ".const"))
+        {
+            this->parse_constant(utils::string::trim(line.substr(6)));
+        }
+        else if (line.back() == ':' && line.find(' ') == std::string_view::npos)
+        {
+            auto& scope = scopes_.back();
+            scope.labels[line.substr(0, line.size() - 1)] = scope.func->code.size();
+        }
+        else
+        {
+            this->assemble_instruction(line);
+        }
+    }
+
+    if (!scopes_.empty())
+    {
+        ASSEMBLER_ERROR("missing end of function '%s'", scopes_.back().func->name.data());
+    }
+
+    if (!has_main)
+    {
+        ASSEMBLER_ERROR("no function found");
+    }
+
+    return file;
+}
+
+// sub_NAME [flag: 2, params: 0, upvals: 0, registers: 2, instructions: 202, constants: 40]
+void assembler::parse_function(lui::file& file, std::string_view line)
+{
+    lui::function* func;
+
+    if (scopes_.empty())
+    {
+        func = &file.main;
+    }
+    else
+    {
+        auto& parent = *scopes_.back().func;
+        parent.sub_funcs.push_back(lui::function());
+        func = &parent.sub_funcs.back();
+    }
+
+    auto info = line.find('[');
+    func->name = std::string(utils::string::trim(line.substr(4, info - 4)));
+    func->upval_count = 0;
+    func->param_count = 0;
+    func->vararg_flags = 0;
+    func->register_count = 0;
+    func->debug = 0;
+
+    if (info != std::string_view::npos)
+    {
+        auto fields = line.substr(info + 1, line.rfind(']') - info - 1);
+
+        while (!fields.empty())
+        {
+            auto next = fields.find(',');
+            auto field = fields.substr(0, next);
+            fields = (next == std::string_view::npos) ? std::string_view() : fields.substr(next + 1);
+
+            auto sep = field.find(':');
+            if (sep == std::string_view::npos) continue;
+
+            auto key = utils::string::trim(field.substr(0, sep));
+            auto value = parse_number(utils::string::trim(field.substr(sep + 1)), 10);
+
+            if (key == "flag") func->vararg_flags = value;
+            else if (key == "params") func->param_count = value;
+            else if (key == "upvals") func->upval_count = value;
+            else if (key == "registers") func->register_count = value;
+        }
+    }
+
+    scopes_.push_back(scope { func, {}, {}, {} });
+}
+
+void assembler::parse_function_end()
+{
+    auto& scope = scopes_.back();
+    auto& func = *scope.func;
+
+    for (auto& [index, name] : scope.jumps)
+    {
+        auto itr = scope.labels.find(name);
+
+        if (itr == scope.labels.end())
+        {
+            ASSEMBLER_ERROR("undefined label '%.*s' in function '%s'", int(name.size()), name.data(), func.name.data());
+        }
+
+        auto sBx = std::int32_t(itr->second) - std::int32_t(index + 1);
+
+        func.code.at(index) |= std::uint32_t(sBx + MAXARG_sBx) << POS_Bx;
+    }
+
+    func.instruction_count = func.code.size();
+    func.constant_count = func.constants.size();
+    func.sub_func_count = func.sub_funcs.size();
+
+    scopes_.pop_back();
+}
+
+void assembler::parse_constant(std::string_view text)
+{
+    auto& scope = scopes_.back();
+    auto& constants = scope.func->constants;
+
+    scope.constants.emplace(text, constants.size());
+
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"')
+    {
+        constants.push_back(lui::kst::string(strings_->intern(utils::string::unquote(text.substr(1, text.size() - 2)))));
+    }
+    else if (text == "nil")
+    {
+        constants.push_back(lui::kst::nil());
+    }
+    else if (text == "true" || text == "false")
+    {
+        constants.push_back(lui::kst::boolean(text == "true"));
+    }
+    else
+    {
+        auto value = std::string(text);
+        char* end = nullptr;
+        auto number = std::strtof(value.data(), &end);
+
+        if (value.empty() || *end != '\0')
+        {
+            ASSEMBLER_ERROR("line %zu: invalid constant '%s'", line_, value.data());
+        }
+
+        constants.push_back(lui::kst::number(number));
+    }
+}
+
+// KST("text"), KST(1.5), KST(nil@1F): the @index suffix picks one of several equal constants
+auto assembler::resolve_constant(std::string_view text) -> std::uint32_t
+{
+    auto& scope = scopes_.back();
+    auto split = (!text.empty() && text.front() == '"') ? text.rfind('"') : 0;
+    auto at = text.find('@', split);
+
+    if (at != std::string_view::npos)
+    {
+        auto index = std::uint32_t(parse_number(text.substr(at + 1), 16));
+
+        if (index >= scope.func->constants.size())
+        {
+            ASSEMBLER_ERROR("line %zu: constant index %X out of range", line_, index);
+        }
+
+        return index;
+    }
+
+    auto itr = scope.constants.find(text);
+
+    if (itr != scope.constants.end())
+    {
+        return itr->second;
+    }
+
+    // not in the listed pool, append it
+    this->parse_constant(text);
+    return scope.func->constants.size() - 1;
+}
+
+auto assembler::parse_number(std::string_view text, int base) -> std::int32_t
+{
+    std::int32_t value = 0;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), value, base);
+
+    if (res.ec != std::errc() || res.ptr != text.data() + text.size())
+    {
+        ASSEMBLER_ERROR("line %zu: invalid number '%.*s'", line_, int(text.size()), text.data());
+    }
+
+    return value;
+}
+
+// splits on top level commas into operands_, KST string operands may contain
+// commas and parens
+void assembler::parse_operands(std::string_view text)
+{
+    operands_.clear();
+
+    auto quoted = false;
+    auto depth = 0;
+    std::size_t begin = 0;
+
+    for (std::size_t i = 0; i <= text.size(); i++)
+    {
+        if (i < text.size())
+        {
+            auto c = text[i];
+
+            if (quoted)
+            {
+                if (c == '\\') i++;
+                else if (c == '"') quoted = false;
+                continue;
+            }
+
+            if (c == '"') { quoted = true; continue; }
+            if (c == '(') { depth++; continue; }
+            if (c == ')') { depth--; continue; }
+            if (c != ',' || depth != 0) continue;
+        }
+
+        auto token = utils::string::trim(text.substr(begin, i - begin));
+        begin = i + 1;
+
+        if (token.empty()) continue;
+
+        auto open = token.find('(');
+
+        if (open != std::string_view::npos && token.back() == ')')
+        {
+            operands_.push_back({ token.substr(0, open), token.substr(open + 1, token.size() - open - 2) });
+        }
+        else
+        {
+            operands_.push_back({ token, {} });
+        }
+    }
+}
+
+void assembler::assemble_instruction(std::string_view line)
+{
+    auto& scope = scopes_.back();
+    auto& func = *scope.func;
+
+    auto space = line.find(' ');
+    auto id = opcode_id(line.substr(0, space));
+
+    if (id == opcode::HKS_OPCODE_MAX)
+    {
+        ASSEMBLER_ERROR("line %zu: unknown opcode '%.*s'", line_, int(line.substr(0, space).size()), line.data());
+    }
+
+    auto& info = opcode_table[std::size_t(id)];
+    parse_operands((space == std::string_view::npos) ? std::string_view() : line.substr(space + 1));
+
+    std::array<std::int32_t, 4> values {};
+    std::array<bool, 4> konst {};
+    std::size_t count = 0;
+
+    for (auto& op : operands_)
+    {
+        if (count + 2 > values.size())
+        {
+            ASSEMBLER_ERROR("line %zu: too many operands", line_);
+        }
+
+        if (op.name == "KST")
+        {
+            konst[count] = true;
+            values[count++] = resolve_constant(op.value);
+        }
+        else if (op.name == "R") // register range 'XX .. YY'
+        {
+            auto sep = op.value.find("..");
+            values[count++] = parse_number(utils::string::trim(op.value.substr(0, sep)), 16);
+            values[count++] = parse_number(utils::string::trim(op.value.substr(sep + 2)), 16);
+        }
+        else if (op.name == "PC")
+        {
+            values[count++] = parse_number(op.value, 10);
+        }
+        else if (op.name == "BOOL")
+        {
+            values[count++] = parse_number(op.value, 10);
+        }
+        else if (op.value.empty() && utils::string::starts_with(op.name, "LOC_"))
+        {
+            scope.jumps.push_back({ std::uint32_t(func.code.size()), op.name });
+            values[count++] = 0;
+        }
+        else
+        {
+            values[count++] = parse_number(op.value, 16);
+        }
+    }
+
+    if (id == opcode::HKS_OPCODE_SETLIST && count == 3) // listed as R(C .. B)
+    {
+        std::swap(values[1], values[2]);
+    }
+
+    std::array<oparg, 3> kinds = { info.A, info.B, info.C };
+    std::array<std::int32_t, 3> fields {};
+    std::size_t slot = 0;
+
+    for (auto i = 0u; i < kinds.size(); i++)
+    {
+        if (kinds[i] == oparg::N) continue;
+
+        if (slot == count)
+        {
+            ASSEMBLER_ERROR("line %zu: missing operands for %s", line_, info.name.data());
+        }
+
+        fields[i] = values[slot];
+
+        if (i == 2 && kinds[i] == oparg::RK && konst[slot])
+        {
+            fields[i] |= 0x100;
+        }
+
+        slot++;
+    }
+
+    if (slot != count)
+    {
+        ASSEMBLER_ERROR("line %zu: too many operands for %s", line_, info.name.data());
+    }
+
+    std::uint32_t value = std::uint32_t(id) << POS_OP;
+
+    if (fields[0] < 0 || fields[0] > 0xFF)
+    {
+        ASSEMBLER_ERROR("line %zu: operand A out of range", line_);
+    }
+
+    value |= std::uint32_t(fields[0]) << POS_A;
+
+    switch (info.mode)
+    {
+    case opmode::ABC:
+        if (fields[1] < 0 || fields[1] > 0xFF || fields[2] < 0 || fields[2] > 0x1FF)
+        {
+            ASSEMBLER_ERROR("line %zu: operand B/C out of range", line_);
+        }
+
+        value |= std::uint32_t(fields[1]) << POS_B;
+        value |= std::uint32_t(fields[2]) << POS_C;
+        break;
+    case opmode::ABx:
+        if (fields[1] < 0 || fields[1] > MAXARG_Bx)
+        {
+            ASSEMBLER_ERROR("line %zu: operand Bx out of range", line_);
+        }
+
+        value |= std::uint32_t(fields[1]) << POS_Bx;
+        break;
+    case opmode::AsBx:
+        // jumps to labels are patched at the end of the function
+        if (kinds[1] == oparg::J && !scope.jumps.empty() && scope.jumps.back().first == func.code.size())
+            break;
+
+        if (fields[1] < -MAXARG_sBx || fields[1] > MAXARG_sBx)
+        {
+            ASSEMBLER_ERROR("line %zu: operand sBx out of range", line_);
+        }
+
+        value |= std::uint32_t(fields[1] + MAXARG_sBx) << POS_Bx;
+        break;
+    }
+
+    func.code.push_back(value);
 }
 
 } // namespace IW6
@@ -11,20 +11,59 @@ namespace IW6
 
 class assembler : public lui::assembler
 {
+    // function being parsed from the listing, labels and constants are keyed
+    // by views into the source text
+    struct scope
+    {
+        lui::function* func;
+        std::unordered_map<std::string_view, std::uint32_t> labels;
+        std::unordered_map<std::string_view, std::uint32_t> constants;
+        std::vector<std::pair<std::uint32_t, std::string_view>> jumps;
+    };
+
+    struct operand
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    // output offsets where each function's fields and code start, for locate()
+    struct section
+    {
+        std::size_t offset;
+        std::string name;
+        std::int64_t instructions; // -1 for function fields
+    };
+
     utils::byte_buffer_ptr output_;
+    std::vector<section> layout_;
+    std::vector<scope> scopes_;
+    std::vector<operand> operands_;     // of the current instruction, reused
+    utils::string_pool* strings_;
+    std::size_t line_;
+
+    friend class bench;
 
 public:
     auto output() -> std::vector<std::uint8_t>;
     void assemble(std::vector<std::uint8_t>& data);
     void assemble(lui::file_ptr data);
+    auto locate(std::size_t offset) -> std::string;
 
 private:
-    void assemble_header();
+    void assemble_header(const lui::header& header);
     void assemble_function(const lui::function& func);
     void assemble_constant(const lui::function& func, std::uint32_t index);
-    void assemble_prototype();
+    void assemble_prototype(const lui::prototype& proto);
 
-    void assemble_instruction();
+    auto parse(std::string_view data) -> lui::file_ptr;
+    void parse_function(lui::file& file, std::string_view line);
+    void parse_function_end();
+    void parse_constant(std::string_view text);
+    void assemble_instruction(std::string_view line);
+    void parse_operands(std::string_view text);
+    auto resolve_constant(std::string_view text) -> std::uint32_t;
+    auto parse_number(std::string_view text, int base) -> std::int32_t;
 };
 
 } // namespace IW6
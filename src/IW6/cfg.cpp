@@ -0,0 +1,313 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "IW6.hpp"
+
+namespace IW6
+{
+
+void cfg::build(const lui::function& func)
+{
+    blocks_.clear();
+    succs_.clear();
+    preds_.clear();
+    rpo_.clear();
+
+    if (func.code.empty()) return;
+
+    this->find_blocks(func);
+    this->link_blocks(func);
+    this->order_blocks();
+    this->find_dominators();
+    this->number_dominator_tree();
+}
+
+auto cfg::successors(std::uint32_t id) const -> range
+{
+    const auto& b = blocks_.at(id);
+    return { succs_.data() + b.succ_begin, succs_.data() + b.succ_begin + b.succ_count };
+}
+
+auto cfg::predecessors(std::uint32_t id) const -> range
+{
+    const auto& b = blocks_.at(id);
+    return { preds_.data() + b.pred_begin, preds_.data() + b.pred_begin + b.pred_count };
+}
+
+auto cfg::dominated(std::uint32_t id) const -> range
+{
+    return { dom_children_.data() + dom_begin_.at(id), dom_children_.data() + dom_begin_.at(id + 1) };
+}
+
+auto cfg::dominates(std::uint32_t a, std::uint32_t b) const -> bool
+{
+    if (!this->reachable(a) || !this->reachable(b)) return false;
+
+    return dom_pre_[a] <= dom_pre_[b] && dom_post_[b] <= dom_post_[a];
+}
+
+auto cfg::branch_targets(const lui::instruction& inst, std::uint32_t index, std::uint32_t count,
+    std::uint32_t* targets) -> std::uint32_t
+{
+    std::uint32_t n = 0;
+
+    auto add = [&](std::int64_t target)
+    {
+        if (target < 0 || target >= count) return;
+        if (n > 0 && targets[0] == target) return;
+        targets[n++] = std::uint32_t(target);
+    };
+
+    auto jump = std::int64_t(index) + 1 + inst.sBx;
+
+    switch (opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_JMP:
+    case opcode::HKS_OPCODE_FORPREP:
+        add(jump);
+        break;
+    case opcode::HKS_OPCODE_FORLOOP:
+        add(jump);
+        add(index + 1);
+        break;
+    // skip the next instruction (normally a JMP) when the condition fails
+    case opcode::HKS_OPCODE_TEST:
+    case opcode::HKS_OPCODE_TEST_R1:
+    case opcode::HKS_OPCODE_TESTSET:
+    case opcode::HKS_OPCODE_EQ:
+    case opcode::HKS_OPCODE_EQ_BK:
+    case opcode::HKS_OPCODE_LT:
+    case opcode::HKS_OPCODE_LT_BK:
+    case opcode::HKS_OPCODE_LE:
+    case opcode::HKS_OPCODE_LE_BK:
+    case opcode::HKS_OPCODE_TFORLOOP:
+        add(index + 1);
+        add(index + 2);
+        break;
+    case opcode::HKS_OPCODE_LOADBOOL:
+        add((inst.C != 0) ? index + 2 : index + 1);
+        break;
+    case opcode::HKS_OPCODE_RETURN:
+        break;
+    default:
+        add(index + 1);
+        break;
+    }
+
+    return n;
+}
+
+void cfg::find_blocks(const lui::function& func)
+{
+    auto count = std::uint32_t(func.code.size());
+    std::uint32_t targets[2];
+
+    // mark leaders, then number blocks in instruction order
+    block_of_.assign(count, 0);
+    block_of_[0] = 1;
+
+    for (auto i = 0u; i < count; i++)
+    {
+        auto n = branch_targets(decode_instruction(func, i), i, count, targets);
+
+        if (n == 1 && targets[0] == i + 1) continue;
+
+        if (i + 1 < count) block_of_[i + 1] = 1;
+
+        for (auto t = 0u; t < n; t++)
+        {
+            block_of_[targets[t]] = 1;
+        }
+    }
+
+    for (auto i = 0u; i < count; i++)
+    {
+        if (block_of_[i])
+        {
+            if (!blocks_.empty()) blocks_.back().end = i;
+            blocks_.push_back({ i, count, 0, 0, 0, 0, none, none });
+        }
+
+        block_of_[i] = std::uint32_t(blocks_.size() - 1);
+    }
+}
+
+void cfg::link_blocks(const lui::function& func)
+{
+    auto count = std::uint32_t(func.code.size());
+    std::uint32_t targets[2];
+
+    for (auto& b : blocks_)
+    {
+        auto last = b.end - 1;
+        auto n = branch_targets(decode_instruction(func, last), last, count, targets);
+
+        b.succ_begin = std::uint32_t(succs_.size());
+        b.succ_count = n;
+
+        for (auto t = 0u; t < n; t++)
+        {
+            auto to = block_of_[targets[t]];
+            succs_.push_back(to);
+            blocks_[to].pred_count++;
+        }
+    }
+
+    // predecessors by counting sort over the successor lists
+    auto offset = 0u;
+
+    for (auto& b : blocks_)
+    {
+        b.pred_begin = offset;
+        offset += b.pred_count;
+        b.pred_count = 0;
+    }
+
+    preds_.resize(offset);
+
+    for (auto id = 0u; id < blocks_.size(); id++)
+    {
+        for (auto to : this->successors(id))
+        {
+            auto& b = blocks_[to];
+            preds_[b.pred_begin + b.pred_count++] = id;
+        }
+    }
+}
+
+void cfg::order_blocks()
+{
+    // iterative depth-first walk, the stack holds (block, next successor)
+    scratch_.assign(blocks_.size(), 0);
+
+    stack_.push_back({ 0, 0 });
+    scratch_[0] = 1;
+
+    while (!stack_.empty())
+    {
+        auto& [id, next] = stack_.back();
+        const auto& b = blocks_[id];
+
+        if (next < b.succ_count)
+        {
+            auto to = succs_[b.succ_begin + next++];
+
+            if (!scratch_[to])
+            {
+                scratch_[to] = 1;
+                stack_.push_back({ to, 0 });
+            }
+        }
+        else
+        {
+            rpo_.push_back(id);
+            stack_.pop_back();
+        }
+    }
+
+    std::reverse(rpo_.begin(), rpo_.end());
+
+    for (auto i = 0u; i < rpo_.size(); i++)
+    {
+        blocks_[rpo_[i]].order = i;
+    }
+}
+
+void cfg::find_dominators()
+{
+    // cooper, harvey & kennedy. lua 5.1 bytecode has no goto, so the graph is
+    // reducible and this settles after one pass plus one to confirm
+    blocks_[0].idom = 0;
+
+    for (auto changed = true; changed; )
+    {
+        changed = false;
+
+        for (auto i = 1u; i < rpo_.size(); i++)
+        {
+            auto id = rpo_[i];
+            auto idom = none;
+
+            for (auto from : this->predecessors(id))
+            {
+                if (blocks_[from].idom == none) continue;
+
+                idom = (idom == none) ? from : this->intersect(from, idom);
+            }
+
+            if (blocks_[id].idom != idom)
+            {
+                blocks_[id].idom = idom;
+                changed = true;
+            }
+        }
+    }
+
+    blocks_[0].idom = none;
+}
+
+void cfg::number_dominator_tree()
+{
+    // children lists by counting sort over idom, then pre/post numbers for
+    // constant time dominance queries
+    dom_begin_.assign(blocks_.size() + 1, 0);
+
+    for (const auto& b : blocks_)
+    {
+        if (b.idom != none) dom_begin_[b.idom + 1]++;
+    }
+
+    for (auto i = 1u; i < dom_begin_.size(); i++)
+    {
+        dom_begin_[i] += dom_begin_[i - 1];
+    }
+
+    dom_children_.resize(dom_begin_.back());
+    scratch_.assign(dom_begin_.begin(), dom_begin_.end() - 1);
+
+    for (auto id : rpo_)
+    {
+        auto idom = blocks_[id].idom;
+        if (idom != none) dom_children_[scratch_[idom]++] = id;
+    }
+
+    dom_pre_.assign(blocks_.size(), none);
+    dom_post_.assign(blocks_.size(), none);
+
+    std::uint32_t clock = 0;
+
+    stack_.push_back({ 0, dom_begin_[0] });
+    dom_pre_[0] = clock++;
+
+    while (!stack_.empty())
+    {
+        auto& [id, next] = stack_.back();
+
+        if (next < dom_begin_[id + 1])
+        {
+            auto child = dom_children_[next++];
+            dom_pre_[child] = clock++;
+            stack_.push_back({ child, dom_begin_[child] });
+        }
+        else
+        {
+            dom_post_[id] = clock++;
+            stack_.pop_back();
+        }
+    }
+}
+
+auto cfg::intersect(std::uint32_t a, std::uint32_t b) const -> std::uint32_t
+{
+    while (a != b)
+    {
+        while (blocks_[a].order > blocks_[b].order) a = blocks_[a].idom;
+        while (blocks_[b].order > blocks_[a].order) b = blocks_[b].idom;
+    }
+
+    return a;
+}
+
+} // namespace IW6
@@ -0,0 +1,83 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_IW6_CFG_HPP_
+#define _LUI_IW6_CFG_HPP_
+
+namespace IW6
+{
+
+// control-flow graph of one function. blocks, edges and the dominator tree
+// live in flat arrays indexed by block id, edges are stored as ranges into
+// shared successor/predecessor lists. block 0 is the entry.
+class cfg
+{
+public:
+    static constexpr std::uint32_t none = 0xFFFFFFFF;
+
+    struct block
+    {
+        std::uint32_t begin;        // first instruction
+        std::uint32_t end;          // one past the last instruction
+        std::uint32_t succ_begin;
+        std::uint32_t succ_count;
+        std::uint32_t pred_begin;
+        std::uint32_t pred_count;
+        std::uint32_t idom;         // none for the entry and unreachable blocks
+        std::uint32_t order;        // reverse postorder index, none if unreachable
+    };
+
+    struct range
+    {
+        const std::uint32_t* first;
+        const std::uint32_t* last;
+
+        auto begin() const -> const std::uint32_t* { return first; }
+        auto end() const -> const std::uint32_t* { return last; }
+        auto size() const -> std::size_t { return last - first; }
+    };
+
+private:
+    std::vector<block> blocks_;
+    std::vector<std::uint32_t> block_of_;
+    std::vector<std::uint32_t> succs_;
+    std::vector<std::uint32_t> preds_;
+    std::vector<std::uint32_t> rpo_;
+    std::vector<std::uint32_t> dom_children_;
+    std::vector<std::uint32_t> dom_begin_;
+    std::vector<std::uint32_t> dom_pre_;
+    std::vector<std::uint32_t> dom_post_;
+    std::vector<std::uint32_t> scratch_;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> stack_;
+
+public:
+    void build(const lui::function& func);
+
+    auto size() const -> std::size_t { return blocks_.size(); }
+    auto at(std::uint32_t id) const -> const block& { return blocks_.at(id); }
+    auto block_of(std::uint32_t inst) const -> std::uint32_t { return block_of_.at(inst); }
+    auto successors(std::uint32_t id) const -> range;
+    auto predecessors(std::uint32_t id) const -> range;
+    auto dominated(std::uint32_t id) const -> range;
+    auto reverse_postorder() const -> const std::vector<std::uint32_t>& { return rpo_; }
+    auto reachable(std::uint32_t id) const -> bool { return blocks_.at(id).order != none; }
+    auto dominates(std::uint32_t a, std::uint32_t b) const -> bool;
+
+    // instruction indices control can go to after index, returns the count
+    static auto branch_targets(const lui::instruction& inst, std::uint32_t index, std::uint32_t count,
+        std::uint32_t* targets) -> std::uint32_t;
+
+private:
+    void find_blocks(const lui::function& func);
+    void link_blocks(const lui::function& func);
+    void order_blocks();
+    void find_dominators();
+    void number_dominator_tree();
+    auto intersect(std::uint32_t a, std::uint32_t b) const -> std::uint32_t;
+};
+
+} // namespace IW6
+
+#endif // _LUI_IW6_CFG_HPP_
@@ -10,34 +10,46 @@ namespace IW6
 
 auto decompiler::output() -> std::vector<std::uint8_t>
 {
-    std::string data;
+    utils::text_writer output;
 
-    data += "-- IW6 PC LUI\n-- Decompiled by https://github.com/xensik/lui-tool\n";
-    data += script_->print();
+    output.write("-- IW6 PC LUI\n-- Decompiled by https://github.com/xensik/lui-tool\n");
+    lui::printer(output).print(*script_);
 
-    std::vector<std::uint8_t> output;
-
-    output.resize(data.size());
-    std::memcpy(output.data(), data.data(), output.size());
-
-    return output;
+    return output.release();
 }
 
-void decompiler::decompile(lui::file_ptr file)
+auto decompiler::decompile(lui::file_ptr file) -> bool
 {
+    // the previous file's tree is freed in bulk
+    arena_.clear();
+    error_.clear();
+
     file_ = std::move(file);
-    script_ = std::make_shared<lui::node_script>();
+    script_ = arena_.make<lui::node_script>();
     var_index = -1;
     this->decompile_function(file_->main);
     
     script_->main = lui::child(file_->main.node);
+
+    return error_.empty();
+}
+
+auto decompiler::error() -> const std::string&
+{
+    return error_;
+}
+
+// the first error is the one kept, the rest of the file is not decompiled
+void decompiler::fail(std::string message)
+{
+    if (error_.empty()) error_ = std::move(message);
 }
 
 void decompiler::decompile_function(lui::function& func)
 {
-    auto name = std::make_shared<lui::node_identifier>(func.name);
+    auto name = arena_.make<lui::node_identifier>(func.name);
 
-    auto params = std::make_shared<lui::node_parameters>();
+    auto params = arena_.make<lui::node_parameters>();
 
     if(func.vararg_flags == 2)
     {
@@ -45,28 +57,39 @@ void decompiler::decompile_function(lui::function& func)
     }
     else
     {
-        for(auto i = 0; i < func.param_count; i ++)
+        for(auto i = 0u; i < func.param_count; i ++)
         {
-            auto arg = std::make_shared<lui::node_identifier>(utils::string::va("arg%d", i));
+            auto arg = arena_.make<lui::node_identifier>(utils::string::va("arg%u", i));
             func.stack.push_back(arg);
             params->list.push_back(lui::child(arg));
         }
     }
 
-    for(auto i = func.param_count; i < func.register_count; i++)
+    // a vararg function keeps its parameters in registers too
+    for(auto i = std::uint32_t(func.stack.size()); i < func.register_count; i++)
     {
-        auto var = std::make_shared<lui::node_nil>();
+        auto var = arena_.make<lui::node_nil>();
         func.stack.push_back(var);
     }
 
-    auto block = std::make_shared<lui::node_block>();
+    auto block = arena_.make<lui::node_block>();
 
-    func.node = std::make_shared<lui::node_function>(lui::child(name), lui::child(params), lui::child(block));
+    func.node = arena_.make<lui::node_function>(lui::child(name), lui::child(params), lui::child(block));
 
-    for(std::uint32_t i = 0; i < func.instruction_count; i++)
-    {
-        this->decompile_instruction(func, i);
-    }
+    cfg_.build(func);
+    live_.build(func, cfg_);
+    this->find_merged(func);
+    block_ = block;
+    loop_exit_ = cfg::none;
+    loop_head_ = cfg::none;
+    multret_ = 0;
+    follow_.assign(1, func.instruction_count);
+    follow_base_ = 0;
+    raw_labels_.clear();
+    tables_.clear();
+
+    this->decompile_range(func, 0, func.instruction_count);
+    this->prune_labels(block);
 
     for(auto& sub : func.sub_funcs)
     {
@@ -75,396 +98,1825 @@ void decompiler::decompile_function(lui::function& func)
     }
 }
 
-void decompiler::decompile_instruction(lui::function& func, std::uint32_t& index)
+void decompiler::decompile_range(lui::function& func, std::uint32_t begin, std::uint32_t end)
 {
-/*#define GET_REG(id) func->registers.at(id).node_
-#define SET_REG(id, n) func->registers.at(id).node_ = n
-#define KST(id) func->constants.at(id)
-#define KST_VAL(id) func->constants.at(id).data_.value()*/
-#define RK(f, c, z) (c < 0 || z) ? std::string(this->find_constant(f, c).print()) : std::string(lui::reg(c).print());
-    
-    auto& inst = func.instructions.at(index);
-    auto op = opcode(inst->OP);
-    auto loc = utils::string::va("%X", inst->index);
-    
-    auto it = func.labels.find(inst->index);
-    if(it != func.labels.end())
+    for(auto i = begin; i < end && error_.empty(); )
     {
-        auto node = std::make_shared<lui::node_label>(it->second);
-        func.node->block.as_block->stmts.push_back(lui::child(node));
+        auto it = func.labels.find(func.code_offset + i * 4);
+
+        // a loop body starting at the header, its label is already out
+        if(it != func.labels.end() && !(i == begin && i == loop_head_))
+        {
+            auto node = arena_.make<lui::node_label>(it->second);
+            this->emit(lui::child(node));
+        }
+
+        i = this->decompile_statement(func, i, end);
     }
-    
-    debug_print(func, inst);
-    
-    switch(op)
-    {
-    case opcode::HKS_OPCODE_GETFIELD: // A B C   R(A) := R(B)[K(C)]
+}
+
+// structured statements are tried first, anything that does not match a known
+// shape falls back to the raw instruction with its labels and jumps
+auto decompiler::decompile_statement(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    auto next = this->decompile_loop(func, index, end);
+
+    if(next != index) return next;
+
+    auto inst = decode_instruction(func, index);
+
+    switch(opcode(inst.OP))
     {
-        auto field_id = lui::child(find_constant(func, inst->C).to_node());
-        auto obj = lui::child(func.stack.at(inst->B));
-        func.stack.at(inst->A) = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
+    case opcode::HKS_OPCODE_TEST:
+    case opcode::HKS_OPCODE_TEST_R1:
+    case opcode::HKS_OPCODE_EQ:
+    case opcode::HKS_OPCODE_EQ_BK:
+    case opcode::HKS_OPCODE_LT:
+    case opcode::HKS_OPCODE_LT_BK:
+    case opcode::HKS_OPCODE_LE:
+    case opcode::HKS_OPCODE_LE_BK:
+        next = this->decompile_boolean(func, index, end);
+        if(next == index) next = this->decompile_logical(func, index, end);
+        if(next == index) next = this->decompile_if(func, index, end);
+        break;
+    case opcode::HKS_OPCODE_TESTSET:
+        next = this->decompile_logical(func, index, end);
+        break;
+    case opcode::HKS_OPCODE_FORPREP:
+        next = this->decompile_for(func, index, end);
+        break;
+    case opcode::HKS_OPCODE_CALL:
+    case opcode::HKS_OPCODE_CALL_I:
+    case opcode::HKS_OPCODE_CALL_I_R1:
+        // an iterator call returning exactly the three for-in control values
+        if(inst.C == 4 && this->find_for_in(func, index + 1, end))
+        {
+            auto jump = decode_instruction(func, index + 1);
+            auto loop = decode_instruction(func, index + 2 + jump.sBx);
+
+            if(loop.A == inst.A) next = this->decompile_for_in(func, index + 1, this->make_call(func, inst));
+        }
+        break;
+    case opcode::HKS_OPCODE_JMP:
+        if(this->find_for_in(func, index, end))
+        {
+            next = this->decompile_for_in(func, index, nullptr);
+        }
+        else if(loop_exit_ != cfg::none && index + 1 + inst.sBx == std::int64_t(loop_exit_))
+        {
+            this->emit(lui::child(arena_.make<lui::node_break>()));
+            next = index + 1;
+        }
+        else if(index + 1 == end && this->is_follow(index + 1 + inst.sBx) &&
+            (index == 0 || handlers()[decode_instruction(func, index - 1).OP] != &decompiler::decompile_test))
+        {
+            // leaves the block the same way falling off its end does, unless
+            // a raw test before it makes it conditional
+            next = index + 1;
+        }
+        break;
+    default:
+        break;
     }
-    break;
-    case opcode::HKS_OPCODE_TEST: // A C     if not (R(A) <=> C) then pc++
+
+    if(next != index) return next;
+
+    this->decompile_instruction(func, index);
+    return index + 1;
+}
+
+// a block entered by a backward JMP from later in the range heads a loop: a
+// test right before that JMP makes it repeat-until, a test at the top that
+// exits past it makes it a while, anything else is while true
+auto decompiler::decompile_loop(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    auto header = cfg_.block_of(index);
+
+    if(cfg_.at(header).begin != index) return index;
+
+    auto latch = cfg::none;
+
+    for(auto pred : cfg_.predecessors(header))
     {
-        auto test = std::make_shared<lui::node_test>(lui::child(func.stack.at(inst->A)), inst->C == 1);
-        func.node->block.as_block->stmts.push_back(lui::child(test));
+        auto last = cfg_.at(pred).end - 1;
+
+        if(last < index || last >= end || !cfg_.dominates(header, pred)) continue;
+        if(opcode(decode_instruction(func, last).OP) != opcode::HKS_OPCODE_JMP) continue;
+        if(latch == cfg::none || last > latch) latch = last;
     }
-    break;
-    case opcode::HKS_OPCODE_CALL_I: // A B C   ?
+
+    if(latch == cfg::none) return index;
+
+    // test; JMP back; JMP out is if test then break end, not the latch. the
+    // back edge closing the loop sits right before where the second JMP goes
+    if(latch > index && latch + 1 < end)
     {
-        func.node->block.as_block->stmts.push_back(decompile_call(func, inst));
+        auto test = decode_instruction(func, latch - 1);
+        auto out = decode_instruction(func, latch + 1);
+        auto to = std::int64_t(latch) + 2 + out.sBx;
+
+        if(handlers()[test.OP] == &decompiler::decompile_test && opcode(test.OP) != opcode::HKS_OPCODE_TESTSET &&
+            opcode(out.OP) == opcode::HKS_OPCODE_JMP && to > latch + 2 && to <= end)
+        {
+            auto back = decode_instruction(func, std::uint32_t(to - 1));
+
+            if(opcode(back.OP) == opcode::HKS_OPCODE_JMP && to + back.sBx == index) latch = std::uint32_t(to - 1);
+        }
     }
-    break;
-    case opcode::HKS_OPCODE_EQ: // A B C   if ((R(B) == RK(C)) ~= A) then PC++
+
+    auto exit = latch + 1;
+    loop_head_ = index;
+
+    if(latch > index)
     {
-        if(inst->A == 0)
+        auto test = decode_instruction(func, latch - 1);
+
+        switch(opcode(test.OP))
         {
-            auto node = std::make_shared<lui::node_not_equal>(func.stack.at(inst->B), (inst->C < 0 || inst->sZero) ? this->find_constant(func, inst->C).to_node() : func.stack.at(inst->C));
-            func.node->block.as_block->stmts.push_back(lui::child(node));
-        }
-        else
+        case opcode::HKS_OPCODE_TEST:
+        case opcode::HKS_OPCODE_TEST_R1:
+        case opcode::HKS_OPCODE_EQ:
+        case opcode::HKS_OPCODE_EQ_BK:
+        case opcode::HKS_OPCODE_LT:
+        case opcode::HKS_OPCODE_LT_BK:
+        case opcode::HKS_OPCODE_LE:
+        case opcode::HKS_OPCODE_LE_BK:
         {
-            auto node = std::make_shared<lui::node_equal>(func.stack.at(inst->B),  (inst->C < 0 || inst->sZero) ? this->find_constant(func, inst->C).to_node() : func.stack.at(inst->C));
-            func.node->block.as_block->stmts.push_back(lui::child(node));
+            auto block = this->decompile_block(func, index, latch - 1, exit, cfg::none);
+            auto cond = this->make_condition(func, test, false);
+            this->emit(lui::child(arena_.make<lui::node_repeat>(lui::child(block), lui::child(cond))));
+            return exit;
+        }
+        default:
+            break;
         }
     }
-    break;
-    case opcode::HKS_OPCODE_EQ_BK: // A B C   if ((K(B) == R(C)) ~= A) then PC++
+
+    auto first = this->find_pure_end(func, index, latch);
+
+    if(this->find_chain(func, first, latch, exit))
+    {
+        auto body = chain_.back().test + 2;
+        auto cond = this->build_condition(func, index);
+        auto block = this->decompile_block(func, body, latch, exit, cfg::none);
+        this->emit(lui::child(arena_.make<lui::node_while>(lui::child(cond), lui::child(block))));
+        return exit;
+    }
+
+    auto cond = arena_.make<lui::node_boolean>(true);
+    auto block = this->decompile_block(func, index, latch, exit, cfg::none);
+    this->emit(lui::child(arena_.make<lui::node_while>(lui::child(cond), lui::child(block))));
+    return exit;
+}
+
+auto decompiler::decompile_if(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    if(!this->find_chain(func, index, end, cfg::none))
     {
-        if(inst->A == 0)
+        // a lone test jumping out of the enclosing loop
+        auto inst = decode_instruction(func, index);
+        auto jump = decode_instruction(func, index + 1);
+
+        if(index + 1 < end && opcode(jump.OP) == opcode::HKS_OPCODE_JMP && loop_exit_ != cfg::none &&
+            index + 2 + jump.sBx == std::int64_t(loop_exit_))
         {
-            auto node = std::make_shared<lui::node_not_equal>(find_constant(func, inst->B).to_node(), func.stack.at(inst->C));
-            func.node->block.as_block->stmts.push_back(lui::child(node));
+            auto block = arena_.make<lui::node_block>();
+            block->stmts.push_back(lui::child(arena_.make<lui::node_break>()));
+
+            auto cond = this->make_condition(func, inst, true);
+            this->emit(lui::child(arena_.make<lui::node_if>(lui::child(cond), lui::child(block))));
+            return index + 2;
         }
-        else
+
+        // test; JMP on; JMP out, where on is the same as falling off the end
+        if(index + 3 == end && end < func.instruction_count && opcode(jump.OP) == opcode::HKS_OPCODE_JMP &&
+            loop_exit_ != cfg::none && opcode(inst.OP) != opcode::HKS_OPCODE_TESTSET)
         {
-            auto node = std::make_shared<lui::node_equal>(find_constant(func, inst->B).to_node(), func.stack.at(inst->C));
-            func.node->block.as_block->stmts.push_back(lui::child(node));
+            auto out = decode_instruction(func, index + 2);
+            auto next = decode_instruction(func, end);
+            auto to = std::int64_t(index) + 2 + jump.sBx;
+
+            if(opcode(out.OP) == opcode::HKS_OPCODE_JMP && index + 3 + out.sBx == std::int64_t(loop_exit_) &&
+                (to == end || (opcode(next.OP) == opcode::HKS_OPCODE_JMP && to == end + 1 + next.sBx)))
+            {
+                auto block = arena_.make<lui::node_block>();
+                block->stmts.push_back(lui::child(arena_.make<lui::node_break>()));
+
+                auto cond = this->make_condition(func, inst, false);
+                this->emit(lui::child(arena_.make<lui::node_if>(lui::child(cond), lui::child(block))));
+                return end;
+            }
         }
+
+        return index;
     }
-    break;
-    case opcode::HKS_OPCODE_GETGLOBAL: // A Bx    R(A) := Gbl[Kst(Bx)] 
+
+    auto body = chain_.back().test + 2;
+    auto target = chain_.back().target;
+    auto cond = this->build_condition(func, index);
+
+    // a forward JMP closing the then branch skips over the else branch
+    auto merge = target;
+    auto jump = decode_instruction(func, target - 1);
+
+    if(target - 1 >= body && opcode(jump.OP) == opcode::HKS_OPCODE_JMP)
     {
-        func.stack.at(inst->A) = find_constant(func, inst->Bx).to_node();
+        auto to = std::int64_t(target) + jump.sBx;
+
+        if(to > target && to <= end) merge = std::uint32_t(to);
+        else if(to > end && target < end && this->is_follow(to)) merge = end;
     }
-    break;
-    case opcode::HKS_OPCODE_MOVE: // A B     R(A) := R(B)
+
+    auto then_end = (merge != target) ? target - 1 : target;
+    auto then_block = this->decompile_block(func, body, then_end, loop_exit_, merge);
+    auto stmt = arena_.make<lui::node_if>(lui::child(cond), lui::child(then_block));
+
+    if(merge != target)
     {
-        func.stack.at(inst->A) = func.stack.at(inst->B);
+        stmt->else_block = lui::child(this->decompile_block(func, target, merge, loop_exit_, merge));
     }
-    break;
-    case opcode::HKS_OPCODE_SELF: // A B C   R(A+1) := R(B); R(A) := R(B)[RK(C)]
+    else if(then_block->stmts.size() == 1 && then_block->stmts.front().type() == lui::node_type::stmt_if &&
+        !then_block->stmts.front().as_if->else_block)
     {
-        auto field_id = lui::child(find_constant(func, inst->C).to_node());
-        auto obj = lui::child(func.stack.at(inst->B));
-        auto field = std::make_shared<lui::node_method>(std::move(obj), std::move(field_id));
-        func.stack.at(inst->A) = field;
-        func.stack.at(inst->A + 1) = std::make_shared<lui::node_identifier>("this");
-        // R(A + 1), store the 'this' pointer
+        // if a then if b then ... end end is if a and b then ... end
+        auto inner = then_block->stmts.front().as_if;
+        stmt->cond = lui::child(arena_.make<lui::node_and>(std::move(stmt->cond), std::move(inner->cond)));
+        stmt->then_block = std::move(inner->then_block);
     }
-    break;
-    case opcode::HKS_OPCODE_RETURN: // A B    return R(A), ... ,R(A+B-2)
-    {
-        if (func.instructions.back()->index == inst->index)
-            break;
 
-        if(inst->B >= 1)
-        {
-            auto ret = std::make_shared<lui::node_return>();
+    this->emit(lui::child(stmt));
+    return merge;
+}
 
-            for(auto i = inst->A; i < inst->A + inst->B -1; i++)
-            {
-                ret->stmts.push_back(lui::child(func.stack.at(i)));
-            }
+auto decompiler::decompile_for(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    // FORPREP jumps to the FORLOOP closing the body, which jumps back to the body
+    auto prep = decode_instruction(func, index);
+    auto target = std::int64_t(index) + 1 + prep.sBx;
 
-            func.node->block.as_block->stmts.push_back(lui::child(ret));
-        }
-        else if (inst->B == 0)
-        {
-            
-        }
+    if(target <= index || target >= end) return index;
+
+    auto loop = decode_instruction(func, std::uint32_t(target));
+
+    if(opcode(loop.OP) != opcode::HKS_OPCODE_FORLOOP || loop.A != prep.A || target + 1 + loop.sBx != index + 1)
+        return index;
+
+    auto var = arena_.make<lui::node_identifier>(get_new_variable());
+    auto step = func.stack.at(prep.A + 2);
+
+    if(step->type == lui::node_type::number && static_cast<lui::node_number*>(step)->value == "1")
+        step = nullptr;
+
+    auto init = func.stack.at(prep.A);
+    auto limit = func.stack.at(prep.A + 1);
+    func.stack.at(prep.A + 3) = var;
+
+    auto exit = std::uint32_t(target) + 1;
+    auto block = this->decompile_block(func, index + 1, std::uint32_t(target), exit, cfg::none);
+
+    this->emit(lui::child(arena_.make<lui::node_for>(lui::child(var), lui::child(init), lui::child(limit),
+        lui::child(step), lui::child(block))));
+
+    return exit;
+}
+
+// JMP to a TFORLOOP whose following JMP returns to the instruction after ours
+auto decompiler::find_for_in(const lui::function& func, std::uint32_t index, std::uint32_t end) -> bool
+{
+    if(index >= end) return false;
+
+    auto jump = decode_instruction(func, index);
+
+    if(opcode(jump.OP) != opcode::HKS_OPCODE_JMP) return false;
+
+    auto target = std::int64_t(index) + 1 + jump.sBx;
+
+    if(target <= index || target + 1 >= end) return false;
+
+    auto loop = decode_instruction(func, std::uint32_t(target));
+    auto back = decode_instruction(func, std::uint32_t(target) + 1);
+
+    return opcode(loop.OP) == opcode::HKS_OPCODE_TFORLOOP && opcode(back.OP) == opcode::HKS_OPCODE_JMP &&
+        target + 2 + back.sBx == index + 1;
+}
+
+// index is a JMP find_for_in accepted
+auto decompiler::decompile_for_in(lui::function& func, std::uint32_t index, lui::node_ptr call) -> std::uint32_t
+{
+    auto target = index + 1 + decode_instruction(func, index).sBx;
+    auto loop = decode_instruction(func, target);
+
+    auto list = arena_.make<lui::node_parameters>();
+
+    if(call != nullptr)
+    {
+        list->list.push_back(lui::child(call));
     }
-    break;
-    case opcode::HKS_OPCODE_GETTABLE_S: // A B C   R(A) := R(B)[RK(C)]
-    {
-        auto field_id = lui::child((inst->C < 0 || inst->sZero) ? find_constant(func, inst->C).to_node() : func.stack.at(inst->C));
-        auto obj = lui::child(func.stack.at(inst->B));
-        auto field = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
-        func.stack.at(inst->A) = field;
-    }
-    break;
-    case opcode::HKS_OPCODE_GETTABLE: // A B C   R(A) := R(B)[RK(C)]
-    {
-        auto field_id = lui::child((inst->C < 0 || inst->sZero) ? find_constant(func, inst->C).to_node() : func.stack.at(inst->C));
-        auto obj = lui::child(func.stack.at(inst->B));
-        auto field = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
-        func.stack.at(inst->A) = field;
-    }
-    break;
-    case opcode::HKS_OPCODE_LOADBOOL: // A B C   R(A) := (Bool)B; if (C) pc++  
-    {
-        auto node = std::make_shared<lui::node_boolean>((bool)inst->B);
-        func.stack.at(inst->A) = node;
-    }
-    break;
-    case opcode::HKS_OPCODE_TFORLOOP: // A C    3 internal vars, and user vars in R(A+3) to C
-    break;
-    case opcode::HKS_OPCODE_SETFIELD: // A B C   R(A)[K(B)] := RK(C)
-    {
-        auto obj = lui::child(func.stack.at(inst->A));
-        auto field_id = lui::child(find_constant(func, inst->B).to_node());
-        auto data = (inst->C < 0 || inst->sZero) ? this->find_constant(func, inst->C).to_node() : func.stack.at(inst->C);
-        auto field = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
-        auto node = std::make_shared<lui::node_assign>(lui::child(field), data);
-        func.node->block.as_block->stmts.push_back(lui::child(node));
-    }
-    break;
-    case opcode::HKS_OPCODE_SETTABLE_S:             // A B C   R(A)[R(B)] := RK(C)
-    break;
-    case opcode::HKS_OPCODE_SETTABLE_S_BK:          // A B C   R(A)[K(B)] := RK(C)
-    break;
-    case opcode::HKS_OPCODE_SETTABLE:               // A B C   R(A)[R(B)] := RK(C)
-    break;
-    case opcode::HKS_OPCODE_SETTABLE_BK:            // A B C   R(A)[K(B)] := RK(C)
-    break;
-    case opcode::HKS_OPCODE_TAILCALL_I:             // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-    break;
-    case opcode::HKS_OPCODE_LOADK:                  // A Bx    R(A) := Kst(Bx)
-    {
-        auto kst = find_constant(func, inst->Bx);
-        if(kst.data_.type_ == lui::data::t::STRING)
-            kst.data_.to_literal();
-
-        auto node = kst.to_node();
-        func.stack.at(inst->A) = node;
-    }
-    break;
-    case opcode::HKS_OPCODE_LOADNIL:                // A B     R(A) := ... := R(B) := nil
-    break;
-    case opcode::HKS_OPCODE_SETGLOBAL:              // A Bx    Gbl[Kst(Bx)] := R(A)
-    {
-        auto kst = find_constant(func, inst->Bx).to_node();
-        auto node = std::make_shared<lui::node_assign>(lui::child(kst), func.stack.at(inst->A));
-
-        func.node->block.as_block->stmts.push_back(lui::child(node));
-    }
-    break;
-    case opcode::HKS_OPCODE_JMP:                    // sBx      pc += sBx
-    {
-        auto id = std::make_shared<lui::node_identifier>(utils::string::va("LOC_%X", (inst->index + 4 + (inst->sBx * 4))));
-        auto jmp = std::make_shared<lui::node_jump>(lui::child(id));
-        func.node->block.as_block->stmts.push_back(lui::child(jmp));
-    }
-    break;
-    case opcode::HKS_OPCODE_CALL:                   // A B C   ?
-    break;
-    case opcode::HKS_OPCODE_TAILCALL:               // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-    break;
-    case opcode::HKS_OPCODE_GETUPVAL:               // A B      R(A) := UpValue[B]
-    break;
-    case opcode::HKS_OPCODE_SETUPVAL:               // A B      UpValue[B] := R(A)
-    break;
-    case opcode::HKS_OPCODE_ADD:                    // A B C   R(A) := R(B) + RK(C)
-    break;
-    case opcode::HKS_OPCODE_ADD_BK:                 // A B C   R(A) := K(B) + R(C)
-    break;
-    case opcode::HKS_OPCODE_SUB:                    //  A B C   R(A) := R(B) – RK(C)
-    break;
-    case opcode::HKS_OPCODE_SUB_BK:                 //  A B C   R(A) := K(B) – R(C)
-    break;
-    case opcode::HKS_OPCODE_MUL:                    //  A B C   R(A) := R(B) * RK(C)
-    break;
-    case opcode::HKS_OPCODE_MUL_BK:                 //  A B C   R(A) := K(B) * R(C)
-    break;
-    case opcode::HKS_OPCODE_DIV:                    // A B C   R(A) := R(B) / RK(C)
-    break;
-    case opcode::HKS_OPCODE_DIV_BK:                 // A B C   R(A) := K(B) / R(C)
-    break;
-    case opcode::HKS_OPCODE_MOD:                    // A B C   R(A) := R(B) % RK(C)
-    break;
-    case opcode::HKS_OPCODE_MOD_BK:                 // A B C   R(A) := K(B) % R(C)
-    break;
-    case opcode::HKS_OPCODE_POW:                    // A B C   R(A) := R(B) ^ RK(C)
-    break;
-    case opcode::HKS_OPCODE_POW_BK:                 // A B C   R(A) := K(B) ^ R(C)
-    break;
-    case opcode::HKS_OPCODE_NEWTABLE:               // A B C   R(A) := array=B hash=C
-    {
-        auto node = std::make_shared<lui::node_identifier>(get_new_variable());
-        func.stack.at(inst->A) = node;
-
-        auto table = std::make_shared<lui::node_newtable>();
-
-        // set local ?
-        // make a initializer list for array or hash  != 0
-        auto assign = std::make_shared<lui::node_assign>(lui::child(node), lui::child(table));
-    
-        func.node->block.as_block->stmts.push_back(lui::child(assign));
-    }
-    break;
-    case opcode::HKS_OPCODE_UNM:                    // A B     R(A) := -R(B)
-    break;
-    case opcode::HKS_OPCODE_NOT: // A B     R(A) := not R(B)
-    break;
-    case opcode::HKS_OPCODE_LEN: // A B     R(A) := length of R(B)
-    {
-        auto node = std::make_shared<lui::node_length>(lui::child(func.stack.at(inst->B)));
-        func.stack.at(inst->A) = node;
-        //func.node->block.as_block->stmts.push_back(lui::child(node));
-    }
-    break;
-    case opcode::HKS_OPCODE_LT:                     // A B C   if ((R(B) < RK(C)) ~= A) then PC++
-    break;
-    case opcode::HKS_OPCODE_LT_BK:                  // A B C   if ((K(B) < R(C)) ~= A) then PC++
-    break;
-    case opcode::HKS_OPCODE_LE:                     //  A B C if ((R(B) <= RK(C)) ~= A) then PC++
-    break;
-    case opcode::HKS_OPCODE_LE_BK:                  //  A B C if ((K(B) <= R(C)) ~= A) then PC++
-    break;
-    case opcode::HKS_OPCODE_CONCAT:                 // A B C   R(A) := R(B).. ... ..R(C)
-    {
-        auto concat = std::make_shared<lui::node_concat>();
-
-        auto num =  (inst->C - inst->B) + 1;
-
-        for(auto i = 0; i < num; i++)
+    else
+    {
+        // generator, state and control, trailing nils left out
+        auto count = 3;
+
+        while(count > 1 && func.stack.at(loop.A + count - 1)->type == lui::node_type::nil) count--;
+
+        for(auto i = 0; i < count; i++)
         {
-            concat->list.push_back(func.stack.at(inst->B + i));
+            list->list.push_back(lui::child(func.stack.at(loop.A + i)));
         }
+    }
 
-        func.stack.at(inst->A) = concat;
+    auto vars = arena_.make<lui::node_parameters>();
+
+    for(auto i = 0u; i < loop.C; i++)
+    {
+        auto var = arena_.make<lui::node_identifier>(get_new_variable());
+        func.stack.at(loop.A + 3 + i) = var;
+        vars->list.push_back(lui::child(var));
     }
-    break;
-    case opcode::HKS_OPCODE_TESTSET:                // A B C   if (R(B) <=> C) then R(A) := R(B) else pc++
-        break;
-    case opcode::HKS_OPCODE_FORPREP:                // A sBx   R(A) -= R(A+2); PC += sBx
-        break;
-    case opcode::HKS_OPCODE_FORLOOP:                // A sBx   R(A) += R(A+2) if R(A) <?= R(A+1) then { PC += sBx; R(A+3) = R(A) }
-        break;
-    case opcode::HKS_OPCODE_SETLIST:                // A B C   R(A)[(C-1)*FPF+i] := R(A+i), 1 <= i <= B
-        break;
-    case opcode::HKS_OPCODE_CLOSE:                  // A       close all variables in the stack up to (>=) R(A)
-        break;
-    case opcode::HKS_OPCODE_CLOSURE:                // A Bx    R(A) := closure(KPROTO[Bx], R(A), ... ,R(A+n))
+
+    auto exit = target + 2;
+    auto block = this->decompile_block(func, index + 1, target, exit, cfg::none);
+
+    this->emit(lui::child(arena_.make<lui::node_for_in>(lui::child(vars), lui::child(list), lui::child(block))));
+
+    return exit;
+}
+
+// follow is where control goes after falling off the end of the block, none
+// for loop bodies. jumps to it, or to anything equivalent in the enclosing
+// blocks, leave the block the structured way
+auto decompiler::decompile_block(lui::function& func, std::uint32_t begin, std::uint32_t end,
+    std::uint32_t exit, std::uint32_t follow) -> lui::block_ptr
+{
+    auto block = arena_.make<lui::node_block>();
+    auto parent = block_;
+    auto parent_exit = loop_exit_;
+    auto parent_base = follow_base_;
+    auto parent_size = follow_.size();
+
+    if(follow == cfg::none || !this->is_follow(follow)) follow_base_ = follow_.size();
+
+    if(follow != cfg::none)
     {
-        auto node = std::make_shared<lui::node_identifier>(func.sub_funcs.at(inst->Bx).name);
-        func.stack.at(inst->A) = node;
+        follow_.push_back(end);
+        follow_.push_back(follow);
     }
-    break;
-    case opcode::HKS_OPCODE_VARARG:                 // A B     R(A), R(A+1), ..., R(A+B-1) = vararg
+
+    block_ = block;
+    loop_exit_ = exit;
+
+    this->decompile_range(func, begin, end);
+
+    block_ = parent;
+    loop_exit_ = parent_exit;
+    follow_base_ = parent_base;
+    follow_.resize(parent_size);
+
+    return block;
+}
+
+// a condition turned into a value: a chain of tests jumping to the second of
+// LOADBOOL A 0 1; LOADBOOL A 1 0, or to the first, which it falls into
+auto decompiler::decompile_boolean(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    auto next = this->find_boolean(func, index, end);
+
+    if(next == index) return index;
+
+    auto reg = decode_instruction(func, next - 1).A;
+
+    func.stack.at(reg) = this->build_condition(func, index, true);
+    this->bind(func, next - 1, reg);
+
+    return next;
+}
+
+// end of the boolean value starting at index, index when there is none.
+// leaves its tests in chain_
+auto decompiler::find_boolean(const lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    if(!this->find_chain(func, index, end, cfg::none)) return index;
+
+    auto body = chain_.back().test + 2;
+    auto target = chain_.back().target;
+
+    if(target != body + 1 || target >= end) return index;
+
+    auto first = decode_instruction(func, body);
+    auto second = decode_instruction(func, target);
+
+    if(opcode(first.OP) != opcode::HKS_OPCODE_LOADBOOL || first.B != 0 || first.C == 0) return index;
+    if(opcode(second.OP) != opcode::HKS_OPCODE_LOADBOOL || second.B == 0 || second.C != 0) return index;
+    if(first.A != second.A) return index;
+
+    return target + 1;
+}
+
+// and / or as a value: TESTSET A B C; JMP L; R(A) := rhs; L:. C set means
+// R(B) is kept when true, which is or. tests in front of an or whose jumps
+// skip to the rhs guard the lhs: (guard and lhs) or rhs
+auto decompiler::decompile_logical(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    std::vector<std::uint32_t> guards;
+    auto i = index;
+
+    for(; i + 1 < end; i = this->find_pure_end(func, i + 2, end))
     {
-        auto node = std::make_shared<lui::node_vararg>();
-        func.stack.at(inst->A) = node;
+        auto inst = decode_instruction(func, i);
+        auto jump = decode_instruction(func, i + 1);
+
+        if(opcode(jump.OP) != opcode::HKS_OPCODE_JMP || jump.sBx < 0) return index;
+        if(opcode(inst.OP) == opcode::HKS_OPCODE_TESTSET) break;
+        if(jump.sBx == 0) return index;
+        if(handlers()[inst.OP] != &decompiler::decompile_test) return index;
+
+        guards.push_back(i);
     }
-    break;
-    case opcode::HKS_OPCODE_TAILCALL_I_R1:          // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-        break;
-    case opcode::HKS_OPCODE_CALL_I_R1:              // A B C   ?
-        func.node->block.as_block->stmts.push_back(decompile_call(func, inst));
-        break;
-    case opcode::HKS_OPCODE_SETUPVAL_R1:            // A B      UpValue[B] := R(A)
-        break;
-    case opcode::HKS_OPCODE_TEST_R1:                // A C     if not (R(A) <=> C) then pc++
+
+    if(i + 2 >= end) return index;
+
+    auto inst = decode_instruction(func, i);
+    auto body = i + 2;
+    auto target = std::uint32_t(body + decode_instruction(func, i + 1).sBx);
+
+    if(!guards.empty() && inst.C == 0) return index;
+    if(target > end) return index;
+
+    // no rhs means it was already in R(A)
+    if(target == body && guards.empty())
     {
-        bool is_not = inst->C == 1;
-        auto test = std::make_shared<lui::node_test>(lui::child(func.stack.at(inst->A)), is_not);
-        func.node->block.as_block->stmts.push_back(lui::child(test));
+        auto lvalue = func.stack.at(inst.B);
+        auto rvalue = func.stack.at(inst.A);
+
+        lui::node_ptr value;
+
+        if(inst.C != 0)
+            value = arena_.make<lui::node_or>(lui::child(lvalue), lui::child(rvalue));
+        else
+            value = arena_.make<lui::node_and>(lui::child(lvalue), lui::child(rvalue));
+
+        // a local keeps its name, the value is stored back to it
+        if(std::find(locals_.begin(), locals_.end(), rvalue) != locals_.end())
+            this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(rvalue), lui::child(value))));
+        else
+            func.stack.at(inst.A) = value;
+
+        return target;
     }
-    break;
-    case opcode::HKS_OPCODE_NOT_R1:                 // A B     R(A) := not R(B)
-        break;
-    case opcode::HKS_OPCODE_GETFIELD_R1:            // A B C   R(A) = R(B)[K(C)]
+
+    if(!this->is_expression(func, body, target, inst.A)) return index;
+
+    for(auto guard : guards)
     {
-        auto field_id = lui::child(find_constant(func, inst->C).to_node());
-        auto obj = lui::child(func.stack.at(inst->B));
-        auto field = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
-        func.stack.at(inst->A) = field;
+        if(guard + 2 + decode_instruction(func, guard + 1).sBx != body) return index;
     }
-    break;
-    case opcode::HKS_OPCODE_SETFIELD_R1:            // A B C   R(A)[K(B)] = RK(C)
+
+    std::vector<lui::node_ptr> terms;
+    auto begin = index;
+
+    for(auto guard : guards)
     {
-        auto obj = lui::child(func.stack.at(inst->A));
-        auto field_id = lui::child(find_constant(func, inst->B).to_node());
-        auto data = (inst->C < 0 || inst->sZero) ? this->find_constant(func, inst->C).to_node() : func.stack.at(inst->C);
-        auto field = std::make_shared<lui::node_field>(std::move(obj), std::move(field_id));
-        auto node = std::make_shared<lui::node_assign>(lui::child(field), data);
-        func.node->block.as_block->stmts.push_back(lui::child(node));
+        for(auto j = begin; j < guard; j++)
+        {
+            this->decompile_instruction(func, j);
+        }
+
+        terms.push_back(this->make_condition(func, decode_instruction(func, guard), false));
+        begin = guard + 2;
     }
-    break;
-    case opcode::HKS_OPCODE_DATA:                   // A Bx    ????
-        break;
-    case opcode::HKS_OPCODE_GETGLOBAL_MEM:          // A Bx    R(A) := Gbl[Kst(Bx)]
+
+    for(auto j = begin; j < i; j++)
     {
-        auto konst = find_constant(func, inst->Bx).to_node();
-        func.stack.at(inst->A) = konst;
+        this->decompile_instruction(func, j);
     }
-    break;
-    default:
-        DISASSEMBLER_ERROR("Unhandled opcode %s", opcode_name(opcode(inst->OP)).data());
-        break;
+
+    auto lvalue = func.stack.at(inst.B);
+
+    for(auto j = terms.size(); j-- > 0; )
+    {
+        lvalue = arena_.make<lui::node_and>(lui::child(terms[j]), lui::child(lvalue));
+    }
+
+    auto write = this->find_last(func, body, target);
+    auto last = decode_instruction(func, write);
+    auto call = opcode(last.OP) == opcode::HKS_OPCODE_CALL || opcode(last.OP) == opcode::HKS_OPCODE_CALL_I ||
+        opcode(last.OP) == opcode::HKS_OPCODE_CALL_I_R1;
+
+    // a call result would get a local of its own, it is read after the join
+    auto block = this->decompile_block(func, body, call ? write : target, loop_exit_, target);
+    auto rvalue = call ? lui::node_ptr(this->make_call(func, last)) : func.stack.at(inst.A);
+    auto& stmts = block->stmts;
+
+    // the rhs settled into the local the whole value goes to is taken back
+    if(!call && !stmts.empty() && stmts.back().type() == lui::node_type::assign &&
+        stmts.back().as_assign->lvalue.as_node == rvalue)
+    {
+        rvalue = stmts.back().as_assign->rvalue.as_node;
+        stmts.pop_back();
+    }
+
+    for(auto& stmt : stmts)
+    {
+        if(stmt.type() != lui::node_type::label) this->emit(std::move(stmt));
     }
+
+    if(inst.C != 0)
+        func.stack.at(inst.A) = arena_.make<lui::node_or>(lui::child(lvalue), lui::child(rvalue));
+    else
+        func.stack.at(inst.A) = arena_.make<lui::node_and>(lui::child(lvalue), lui::child(rvalue));
+
+    this->bind(func, write, inst.A);
+
+    return target;
 }
 
-auto decompiler::decompile_call(lui::function& func, const lui::instruction_ptr& inst) -> lui::child
+// whether [begin, end) only computes a value into reg: pure instructions,
+// the last one writing reg or calling for exactly one result into it
+auto decompiler::is_expression(const lui::function& func, std::uint32_t begin, std::uint32_t end,
+    std::uint32_t reg) -> bool
 {
-    std::int32_t arg_num = inst->B - 1;
-    std::int32_t ret_num = inst->C - 1;
+    auto write = this->find_last(func, begin, end);
 
-    auto params = std::make_shared<lui::node_parameters>();
+    if(write == end) return false;
 
-    if(arg_num > 0)
+    // boolean values may sit in between, or be the value itself. an and / or
+    // into reg joining at end is a value too
+    for(auto i = this->find_pure_end(func, begin, write); i != write; i = this->find_pure_end(func, i, write))
     {
-        auto ncall = lui::child(func.stack.at(inst->A));
-        auto i = 1;
-        if(ncall.as_node->type == lui::node_type::method) i = 2;
+        auto inst = decode_instruction(func, i);
 
-        for(; i <= arg_num; i++)
+        if(opcode(inst.OP) == opcode::HKS_OPCODE_TESTSET && inst.A == reg)
         {
-            params->list.push_back(lui::child(func.stack.at(inst->A + i)));
+            auto jump = decode_instruction(func, i + 1);
+
+            return opcode(jump.OP) == opcode::HKS_OPCODE_JMP && i + 2 + jump.sBx == end &&
+                this->is_expression(func, i + 2, end, reg);
         }
+
+        auto next = this->find_boolean(func, i, end);
+
+        if(next == i) return false;
+        if(next == write + 1) return decode_instruction(func, write).A == reg;
+
+        i = next;
     }
-    
-    auto call = std::make_shared<lui::node_call>();
-    call->name = lui::child(func.stack.at(inst->A));
-    call->params = lui::child(params);
 
-    if(ret_num > 0) // ipairs call store rets in R(A+3) and TFORLOOP C count
+    auto last = decode_instruction(func, write);
+
+    if(last.A != reg) return false;
+
+    switch(opcode(last.OP))
     {
-        auto retlist = std::make_shared<lui::node_parameters>();
-        // special ipairs
-        if(call->name.as_node->type == lui::node_type::identifier && call->name.as_identifier->value == "ipairs")
-        {
-            for(auto i = 0; i < 2; i++)
-            {
-                auto var = std::make_shared<lui::node_identifier>(get_new_variable());
-                func.stack.at(inst->A + 3 + i) = var;
-                retlist->list.push_back(lui::child(var));
-            }
-        }
+    case opcode::HKS_OPCODE_CALL:
+    case opcode::HKS_OPCODE_CALL_I:
+    case opcode::HKS_OPCODE_CALL_I_R1:
+        return last.C == 2;
+    case opcode::HKS_OPCODE_LOADNIL:
+    case opcode::HKS_OPCODE_DATA:
+        return false;
+    case opcode::HKS_OPCODE_NEWTABLE:
+        return true;
+    default:
+        return this->find_pure_end(func, write, end) == end;
+    }
+}
+
+// last instruction in [begin, end) that is not the DATA trailing another one,
+// end when there is none
+auto decompiler::find_last(const lui::function& func, std::uint32_t begin, std::uint32_t end) -> std::uint32_t
+{
+    for(auto i = end; i-- > begin; )
+    {
+        if(opcode(decode_instruction(func, i).OP) != opcode::HKS_OPCODE_DATA) return i;
+    }
+
+    return end;
+}
+
+auto decompiler::is_follow(std::int64_t index) -> bool
+{
+    return std::find(follow_.begin() + follow_base_, follow_.end(), index) != follow_.end();
+}
+
+// condition under which the JMP after a compare-and-skip instruction is
+// skipped, or taken when negated
+auto decompiler::make_condition(lui::function& func, const lui::instruction& inst, bool negate) -> lui::node_ptr
+{
+    switch(opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_TEST:
+    case opcode::HKS_OPCODE_TEST_R1:
+    {
+        auto value = func.stack.at(inst.A);
+
+        if((inst.C != 0) == negate) return value;
+
+        return arena_.make<lui::node_not>(lui::child(value));
+    }
+    case opcode::HKS_OPCODE_EQ:
+    case opcode::HKS_OPCODE_EQ_BK:
+    {
+        auto bk = opcode(inst.OP) == opcode::HKS_OPCODE_EQ_BK;
+        auto lvalue = bk ? find_constant(func, inst.B).to_literal_node(arena_) : func.stack.at(inst.B);
+        auto rvalue = bk ? func.stack.at(inst.C) : this->rk(func, inst.C, inst.sZero);
+
+        if((inst.A == 0) != negate)
+            return arena_.make<lui::node_equal>(lui::child(lvalue), lui::child(rvalue));
+
+        return arena_.make<lui::node_not_equal>(lui::child(lvalue), lui::child(rvalue));
+    }
+    case opcode::HKS_OPCODE_LT:
+    case opcode::HKS_OPCODE_LT_BK:
+    case opcode::HKS_OPCODE_LE:
+    case opcode::HKS_OPCODE_LE_BK:
+    {
+        auto op = opcode(inst.OP);
+        auto bk = op == opcode::HKS_OPCODE_LT_BK || op == opcode::HKS_OPCODE_LE_BK;
+        auto lvalue = bk ? find_constant(func, inst.B).to_literal_node(arena_) : func.stack.at(inst.B);
+        auto rvalue = bk ? func.stack.at(inst.C) : this->rk(func, inst.C, inst.sZero);
+
+        lui::node_ptr node;
+
+        if(op == opcode::HKS_OPCODE_LT || op == opcode::HKS_OPCODE_LT_BK)
+            node = arena_.make<lui::node_less>(lui::child(lvalue), lui::child(rvalue));
         else
-        {
-            for(auto i = 0; i < ret_num; i++)
-            {
-                auto var = std::make_shared<lui::node_identifier>(get_new_variable());
-                func.stack.at(inst->A + i) = var;
-                retlist->list.push_back(lui::child(var));
-            }
-        }
-        
-        return lui::child(std::make_shared<lui::node_assign>(lui::child(retlist), lui::child(call)));
+            node = arena_.make<lui::node_less_equal>(lui::child(lvalue), lui::child(rvalue));
+
+        if((inst.A == 0) != negate) return node;
+
+        return arena_.make<lui::node_not>(lui::child(node));
+    }
+    default:
+        this->fail(utils::string::va("%s at 0x%X is not a condition", opcode_name(opcode(inst.OP)).data(), inst.index));
+        return arena_.make<lui::node_nil>();
     }
-    else return lui::child(call);
 }
 
-void decompiler::debug_print(const lui::function& func, const lui::instruction_ptr& inst)
+// folds the chain found by find_chain from the right: a test jumping to the
+// end must hold to go on (and), one jumping to the body enters it (or).
+// negated it is the condition for reaching the end instead
+auto decompiler::build_condition(lui::function& func, std::uint32_t begin, bool negate) -> lui::node_ptr
+{
+    std::vector<lui::node_ptr> terms;
+    auto end = chain_.back().target;
+
+    for(const auto& pair : chain_)
+    {
+        for(auto i = begin; i < pair.test; i++)
+        {
+            this->decompile_instruction(func, i);
+        }
+
+        terms.push_back(this->make_condition(func, decode_instruction(func, pair.test), (pair.target != end) != negate));
+        begin = pair.test + 2;
+    }
+
+    auto cond = terms.back();
+
+    for(auto i = std::int32_t(terms.size()) - 2; i >= 0; i--)
+    {
+        if((chain_.at(i).target == end) != negate)
+            cond = arena_.make<lui::node_and>(lui::child(terms.at(i)), lui::child(cond));
+        else
+            cond = arena_.make<lui::node_or>(lui::child(terms.at(i)), lui::child(cond));
+    }
+
+    return cond;
+}
+
+// longest run of test + forward JMP pairs, separated only by instructions
+// that emit no statement, whose jumps all go to the body after the last pair
+// or to one common end. exit, when set, is the end the chain must reach
+auto decompiler::find_chain(const lui::function& func, std::uint32_t index, std::uint32_t end,
+    std::uint32_t exit) -> bool
+{
+    auto best = 0u;
+    chain_.clear();
+
+    while(index + 1 < end)
+    {
+        auto test = decode_instruction(func, index);
+        auto jump = decode_instruction(func, index + 1);
+
+        switch(opcode(test.OP))
+        {
+        case opcode::HKS_OPCODE_TEST:
+        case opcode::HKS_OPCODE_TEST_R1:
+        case opcode::HKS_OPCODE_EQ:
+        case opcode::HKS_OPCODE_EQ_BK:
+        case opcode::HKS_OPCODE_LT:
+        case opcode::HKS_OPCODE_LT_BK:
+        case opcode::HKS_OPCODE_LE:
+        case opcode::HKS_OPCODE_LE_BK:
+            break;
+        default:
+            chain_.resize(best);
+            return best > 0;
+        }
+
+        auto target = std::int64_t(index) + 2 + jump.sBx;
+
+        if(opcode(jump.OP) != opcode::HKS_OPCODE_JMP || target <= index + 1) break;
+
+        // a jump threaded past the end of the block still just leaves it
+        if(exit == cfg::none && target > end && this->is_follow(target)) target = end;
+
+        chain_.push_back({ index, std::uint32_t(target) });
+
+        auto body = index + 2;
+        auto valid = target > body && (exit == cfg::none ? target <= end : target == exit);
+
+        for(auto i = 0u; valid && i + 1 < chain_.size(); i++)
+        {
+            valid = chain_[i].target == body || chain_[i].target == target;
+        }
+
+        if(valid) best = std::uint32_t(chain_.size());
+
+        index = this->find_pure_end(func, body, end);
+    }
+
+    chain_.resize(best);
+    return best > 0;
+}
+
+// first instruction at or after index that may emit a statement or branch
+auto decompiler::find_pure_end(const lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t
+{
+    for(; index < end; index++)
+    {
+        auto inst = decode_instruction(func, index);
+
+        switch(opcode(inst.OP))
+        {
+        case opcode::HKS_OPCODE_GETFIELD:
+        case opcode::HKS_OPCODE_GETFIELD_R1:
+        case opcode::HKS_OPCODE_GETGLOBAL:
+        case opcode::HKS_OPCODE_GETGLOBAL_MEM:
+        case opcode::HKS_OPCODE_GETTABLE:
+        case opcode::HKS_OPCODE_GETTABLE_S:
+        case opcode::HKS_OPCODE_GETUPVAL:
+        case opcode::HKS_OPCODE_MOVE:
+        case opcode::HKS_OPCODE_SELF:
+        case opcode::HKS_OPCODE_LOADK:
+        case opcode::HKS_OPCODE_LOADNIL:
+        case opcode::HKS_OPCODE_LEN:
+        case opcode::HKS_OPCODE_CONCAT:
+        case opcode::HKS_OPCODE_CLOSURE:
+        case opcode::HKS_OPCODE_VARARG:
+        case opcode::HKS_OPCODE_DATA:
+        case opcode::HKS_OPCODE_ADD:
+        case opcode::HKS_OPCODE_ADD_BK:
+        case opcode::HKS_OPCODE_SUB:
+        case opcode::HKS_OPCODE_SUB_BK:
+        case opcode::HKS_OPCODE_MUL:
+        case opcode::HKS_OPCODE_MUL_BK:
+        case opcode::HKS_OPCODE_DIV:
+        case opcode::HKS_OPCODE_DIV_BK:
+        case opcode::HKS_OPCODE_MOD:
+        case opcode::HKS_OPCODE_MOD_BK:
+        case opcode::HKS_OPCODE_POW:
+        case opcode::HKS_OPCODE_POW_BK:
+        case opcode::HKS_OPCODE_UNM:
+        case opcode::HKS_OPCODE_NOT:
+        case opcode::HKS_OPCODE_NOT_R1:
+            continue;
+        case opcode::HKS_OPCODE_LOADBOOL:
+            if(inst.C == 0) continue;
+            return index;
+        // a result read once further on is printed there, not emitted
+        case opcode::HKS_OPCODE_CALL:
+        case opcode::HKS_OPCODE_CALL_I:
+        case opcode::HKS_OPCODE_CALL_I_R1:
+            if(inst.C == 2 && this->find_use(func, index, inst.A) < liveness::many) continue;
+            return index;
+        default:
+            return index;
+        }
+    }
+
+    return index;
+}
+
+auto decompiler::rk(const lui::function& func, std::int32_t index, bool zero) -> lui::node_ptr
+{
+    if(index < 0 || zero) return find_constant(func, index).to_literal_node(arena_);
+
+    return func.stack.at(index);
+}
+
+void decompiler::emit(lui::child stmt)
+{
+    block_->stmts.push_back(std::move(stmt));
+}
+
+// drops labels no remaining raw jump refers to
+void decompiler::prune_labels(lui::block_ptr block)
+{
+    auto& stmts = block->stmts;
+
+    stmts.erase(std::remove_if(stmts.begin(), stmts.end(), [&](const lui::child& stmt)
+    {
+        return stmt.type() == lui::node_type::label &&
+            raw_labels_.count(static_cast<const lui::node_label*>(stmt.as_node)->loc) == 0;
+    }), stmts.end());
+
+    for(auto& stmt : stmts)
+    {
+        switch(stmt.type())
+        {
+        case lui::node_type::stmt_if:
+            this->prune_labels(stmt.as_if->then_block.as_block);
+            if(stmt.as_if->else_block) this->prune_labels(stmt.as_if->else_block.as_block);
+            break;
+        case lui::node_type::stmt_while:
+            this->prune_labels(static_cast<lui::node_while*>(stmt.as_node)->block.as_block);
+            break;
+        case lui::node_type::stmt_repeat:
+            this->prune_labels(static_cast<lui::node_repeat*>(stmt.as_node)->block.as_block);
+            break;
+        case lui::node_type::stmt_for:
+            this->prune_labels(static_cast<lui::node_for*>(stmt.as_node)->block.as_block);
+            break;
+        case lui::node_type::stmt_for_in:
+            this->prune_labels(static_cast<lui::node_for_in*>(stmt.as_node)->block.as_block);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// one handler per opcode, indexed by the opcode number
+auto decompiler::handlers() -> const std::array<handler, 128>&
+{
+    static const auto table = []
+    {
+        std::array<handler, 128> table;
+        table.fill(&decompiler::decompile_unknown);
+
+        auto set = [&](opcode op, handler func) { table[std::size_t(op)] = func; };
+
+        set(opcode::HKS_OPCODE_GETFIELD, &decompiler::decompile_getfield);
+        set(opcode::HKS_OPCODE_GETFIELD_R1, &decompiler::decompile_getfield);
+        set(opcode::HKS_OPCODE_GETTABLE, &decompiler::decompile_getfield);
+        set(opcode::HKS_OPCODE_GETTABLE_S, &decompiler::decompile_getfield);
+        set(opcode::HKS_OPCODE_SETFIELD, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_SETFIELD_R1, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_SETTABLE, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_SETTABLE_BK, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_SETTABLE_S, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_SETTABLE_S_BK, &decompiler::decompile_setfield);
+        set(opcode::HKS_OPCODE_GETGLOBAL, &decompiler::decompile_getglobal);
+        set(opcode::HKS_OPCODE_GETGLOBAL_MEM, &decompiler::decompile_getglobal);
+        set(opcode::HKS_OPCODE_SETGLOBAL, &decompiler::decompile_setglobal);
+        set(opcode::HKS_OPCODE_GETUPVAL, &decompiler::decompile_getupval);
+        set(opcode::HKS_OPCODE_SETUPVAL, &decompiler::decompile_setupval);
+        set(opcode::HKS_OPCODE_SETUPVAL_R1, &decompiler::decompile_setupval);
+        set(opcode::HKS_OPCODE_MOVE, &decompiler::decompile_move);
+        set(opcode::HKS_OPCODE_LOADK, &decompiler::decompile_loadk);
+        set(opcode::HKS_OPCODE_LOADBOOL, &decompiler::decompile_loadbool);
+        set(opcode::HKS_OPCODE_LOADNIL, &decompiler::decompile_loadnil);
+        set(opcode::HKS_OPCODE_VARARG, &decompiler::decompile_vararg);
+        set(opcode::HKS_OPCODE_CLOSURE, &decompiler::decompile_closure);
+        set(opcode::HKS_OPCODE_NEWTABLE, &decompiler::decompile_newtable);
+        set(opcode::HKS_OPCODE_SETLIST, &decompiler::decompile_setlist);
+        set(opcode::HKS_OPCODE_SELF, &decompiler::decompile_self);
+        set(opcode::HKS_OPCODE_CONCAT, &decompiler::decompile_concat);
+        set(opcode::HKS_OPCODE_UNM, &decompiler::decompile_unary);
+        set(opcode::HKS_OPCODE_NOT, &decompiler::decompile_unary);
+        set(opcode::HKS_OPCODE_NOT_R1, &decompiler::decompile_unary);
+        set(opcode::HKS_OPCODE_LEN, &decompiler::decompile_unary);
+        set(opcode::HKS_OPCODE_TEST, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_TEST_R1, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_EQ, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_EQ_BK, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_LT, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_LT_BK, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_LE, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_LE_BK, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_TESTSET, &decompiler::decompile_test);
+        set(opcode::HKS_OPCODE_JMP, &decompiler::decompile_jump);
+        set(opcode::HKS_OPCODE_CALL, &decompiler::decompile_call);
+        set(opcode::HKS_OPCODE_CALL_I, &decompiler::decompile_call);
+        set(opcode::HKS_OPCODE_CALL_I_R1, &decompiler::decompile_call);
+        set(opcode::HKS_OPCODE_TAILCALL, &decompiler::decompile_tailcall);
+        set(opcode::HKS_OPCODE_TAILCALL_I, &decompiler::decompile_tailcall);
+        set(opcode::HKS_OPCODE_TAILCALL_I_R1, &decompiler::decompile_tailcall);
+        set(opcode::HKS_OPCODE_RETURN, &decompiler::decompile_return);
+
+        // loop control is consumed by the for statements, DATA by the
+        // instruction before it
+        set(opcode::HKS_OPCODE_FORPREP, &decompiler::decompile_skip);
+        set(opcode::HKS_OPCODE_FORLOOP, &decompiler::decompile_skip);
+        set(opcode::HKS_OPCODE_TFORLOOP, &decompiler::decompile_skip);
+        set(opcode::HKS_OPCODE_CLOSE, &decompiler::decompile_skip);
+        set(opcode::HKS_OPCODE_DATA, &decompiler::decompile_skip);
+
+        for (auto i = 0; i < 6; i++)
+        {
+            set(opcode(std::size_t(opcode::HKS_OPCODE_ADD) + i * 2), &decompiler::decompile_binary);
+            set(opcode(std::size_t(opcode::HKS_OPCODE_ADD_BK) + i * 2), &decompiler::decompile_binary);
+        }
+
+        return table;
+    }();
+
+    return table;
+}
+
+void decompiler::decompile_instruction(lui::function& func, std::uint32_t& index)
+{
+    auto inst = decode_instruction(func, index);
+
+    debug_print(func, inst);
+
+    if(!tables_.empty()) this->close_table(func, inst, index);
+
+    (this->*handlers()[inst.OP])(func, inst, index);
+}
+
+// R(A) := R(B)[K(C)] for the field forms, R(B)[RK(C)] for the table forms
+void decompiler::decompile_getfield(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto op = opcode(inst.OP);
+    auto constant = op == opcode::HKS_OPCODE_GETFIELD || op == opcode::HKS_OPCODE_GETFIELD_R1 || inst.sZero;
+
+    func.stack.at(inst.A) = this->make_index(func, func.stack.at(inst.B), inst.C, constant);
+
+    this->settle(func, index, inst.A);
+}
+
+// R(A)[key] := RK(C), the key is R(B) for SETTABLE and SETTABLE_S, K(B) otherwise
+void decompiler::decompile_setfield(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto op = opcode(inst.OP);
+    auto constant = op != opcode::HKS_OPCODE_SETTABLE && op != opcode::HKS_OPCODE_SETTABLE_S;
+    auto value = this->rk(func, inst.C, inst.sZero);
+
+    // a store into a table being built, that does not read the table back,
+    // becomes an entry of its constructor
+    auto self = (!constant && inst.B == inst.A) || (!inst.sZero && inst.C == inst.A);
+    auto table = self ? nullptr : this->fold_target(func, inst.A, index);
+
+    if(table != nullptr)
+    {
+        auto name = false;
+        auto key = this->make_key(func, inst.B, constant, name);
+
+        table->list.push_back(lui::child(arena_.make<lui::node_entry>(lui::child(key), lui::child(value), name)));
+        tables_.back().end = index;
+        return;
+    }
+
+    auto field = this->make_index(func, func.stack.at(inst.A), inst.B, constant);
+
+    this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(field), lui::child(value))));
+}
+
+void decompiler::decompile_getglobal(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    func.stack.at(inst.A) = find_constant(func, inst.Bx).to_node(arena_);
+
+    this->settle(func, index, inst.A);
+}
+
+void decompiler::decompile_setglobal(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    auto kst = find_constant(func, inst.Bx).to_node(arena_);
+    auto node = arena_.make<lui::node_assign>(lui::child(kst), lui::child(func.stack.at(inst.A)));
+
+    this->emit(lui::child(node));
+}
+
+void decompiler::decompile_getupval(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    func.stack.at(inst.A) = arena_.make<lui::node_upvalue>(this->upvalue_name(func, inst.B));
+
+    this->settle(func, index, inst.A);
+}
+
+void decompiler::decompile_setupval(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    auto upval = arena_.make<lui::node_upvalue>(this->upvalue_name(func, inst.B));
+    auto node = arena_.make<lui::node_assign>(lui::child(upval), lui::child(func.stack.at(inst.A)));
+
+    this->emit(lui::child(node));
+}
+
+void decompiler::decompile_move(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto value = func.stack.at(inst.B);
+
+    func.stack.at(inst.A) = value;
+    this->settle(func, index, inst.A);
+
+    // a copy of a local holds its old value only until the local is written
+    // again, a read after that needs a local of its own
+    if(func.stack.at(inst.A) != value || value->type != lui::node_type::identifier) return;
+    if(!this->is_overwritten(func, index, inst.A, static_cast<lui::identifier_ptr>(value))) return;
+
+    auto var = arena_.make<lui::node_identifier>(get_new_variable());
+
+    this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(var), lui::child(value))));
+    func.stack.at(inst.A) = var;
+}
+
+void decompiler::decompile_loadk(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    func.stack.at(inst.A) = find_constant(func, inst.Bx).to_literal_node(arena_);
+
+    this->settle(func, index, inst.A);
+}
+
+// the skip when C is set belongs to a boolean value pattern or a raw jump
+void decompiler::decompile_loadbool(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    func.stack.at(inst.A) = arena_.make<lui::node_boolean>(inst.B != 0);
+
+    this->settle(func, index, inst.A);
+}
+
+void decompiler::decompile_loadnil(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    for(auto i = inst.A; i <= inst.B; i++)
+    {
+        func.stack.at(i) = arena_.make<lui::node_nil>();
+        this->settle(func, index, i);
+    }
+}
+
+// B == 0 leaves every vararg on the stack for the next open call, return
+// or SETLIST
+void decompiler::decompile_vararg(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    auto node = arena_.make<lui::node_vararg>();
+    func.stack.at(inst.A) = node;
+
+    if(inst.B == 0) multret_ = inst.A;
+}
+
+// names the upvalues of the new closure after what the DATA lines after it
+// capture: a local of this function (1) or one of its own upvalues (2)
+void decompiler::decompile_closure(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto& sub = func.sub_funcs.at(inst.Bx);
+
+    sub.upvals.clear();
+
+    for(auto i = 0u; i < sub.upval_count && index + 1 + i < func.code.size(); i++)
+    {
+        auto data = decode_instruction(func, index + 1 + i);
+
+        if(opcode(data.OP) != opcode::HKS_OPCODE_DATA) break;
+
+        if(data.A == 1)
+        {
+            // a captured register is a local, even if only an expression was in it
+            if(func.stack.at(data.Bx)->type != lui::node_type::identifier)
+            {
+                auto var = arena_.make<lui::node_identifier>(get_new_variable());
+                this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(var), lui::child(func.stack.at(data.Bx)))));
+                func.stack.at(data.Bx) = var;
+            }
+
+            sub.upvals.push_back(static_cast<lui::node_identifier*>(func.stack.at(data.Bx))->value);
+        }
+        else if(data.A == 2)
+            sub.upvals.push_back(this->upvalue_name(func, data.Bx));
+        else
+            sub.upvals.push_back(utils::string::va("upval%d", i));
+    }
+
+    func.stack.at(inst.A) = arena_.make<lui::node_identifier>(sub.name);
+}
+
+// B and C are the array and hash sizes as floating point bytes, bounded by
+// the code left since each entry takes an instruction
+void decompiler::decompile_newtable(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto fb2int = [](std::uint32_t x) { return (x < 8) ? x : ((x & 7) | 8) << ((x >> 3) - 1); };
+
+    auto table = arena_.make<lui::node_newtable>();
+    auto hash = std::uint32_t(inst.C | (inst.sZero ? 0x100 : 0));
+    auto size = std::min<std::uint64_t>(std::uint64_t(fb2int(inst.B)) + fb2int(hash & 0xFF), func.code.size() - index);
+
+    table->list.reserve(size);
+
+    auto use = this->find_use(func, index, inst.A);
+
+    // an unread table is dropped, one read once is written where it is read
+    if(use != liveness::many)
+    {
+        func.stack.at(inst.A) = table;
+        return;
+    }
+
+    auto node = this->local(index, inst.A);
+    func.stack.at(inst.A) = node;
+
+    auto assign = arena_.make<lui::node_assign>(lui::child(node), lui::child(table));
+
+    this->emit(lui::child(assign));
+
+    const auto& acc = live_.at(index);
+    auto shared = sizes_[this->find(def_base_[index] + inst.A - acc.def_begin)] >= 2;
+
+    tables_.push_back({ table, std::uint32_t(inst.A), index, shared });
+}
+
+// R(A)[(C-1)*FPF+i] := R(A+i), 1 <= i <= B. values stored right after the
+// table is created go into its constructor, anything else is an index store
+void decompiler::decompile_setlist(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    constexpr auto fields_per_flush = 50u;
+
+    auto block = (inst.C | (inst.sZero ? 0x100 : 0)) - 1;
+    auto first = std::uint32_t(inst.A) + 1;
+    auto last = (inst.B == 0) ? multret_ : inst.A + inst.B;
+    auto base = block * fields_per_flush;
+
+    auto obj = func.stack.at(inst.A);
+    auto table = (obj->type == lui::node_type::newtable) ? static_cast<lui::newtable_ptr>(obj) : this->fold_target(func, inst.A, index);
+
+    if(table != nullptr && table->items == base)
+    {
+        for(auto i = first; i <= last; i++)
+        {
+            table->list.push_back(lui::child(func.stack.at(i)));
+        }
+
+        table->items += last + 1 - first;
+        if(table != obj) tables_.back().end = index;
+        return;
+    }
+
+    for(auto i = first; i <= last; i++)
+    {
+        auto key = arena_.make<lui::node_number>(std::to_string(base + i - inst.A));
+        auto field = arena_.make<lui::node_index>(lui::child(obj), lui::child(key));
+        auto node = arena_.make<lui::node_assign>(lui::child(field), lui::child(func.stack.at(i)));
+
+        this->emit(lui::child(node));
+    }
+}
+
+// the table being built in reg, if its local's assignment is still the last
+// statement and nothing read it since the last entry
+auto decompiler::fold_target(const lui::function& func, std::uint32_t reg, std::uint32_t index) -> lui::newtable_ptr
+{
+    if(tables_.empty() || tables_.back().reg != reg || block_->stmts.empty()) return nullptr;
+
+    const auto& open = tables_.back();
+    const auto& last = block_->stmts.back();
+
+    if(last.type() != lui::node_type::assign || last.as_assign->rvalue.as_node != open.table) return nullptr;
+    if(last.as_assign->lvalue.as_node != func.stack.at(reg)) return nullptr;
+
+    for(auto i = open.end + 1; i < index; i++)
+    {
+        if(live_.reads(i, reg)) return nullptr;
+    }
+
+    return open.table;
+}
+
+// ends the innermost table being built when an instruction other than a store
+// into it reads it. when that is its only read left the constructor moves
+// there, so nested tables end up inside the one they are stored into
+void decompiler::close_table(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    while(!tables_.empty())
+    {
+        auto open = tables_.back();
+
+        if(!live_.reads(index, open.reg)) return;
+
+        switch(opcode(inst.OP))
+        {
+        case opcode::HKS_OPCODE_SETFIELD:
+        case opcode::HKS_OPCODE_SETFIELD_R1:
+        case opcode::HKS_OPCODE_SETTABLE:
+        case opcode::HKS_OPCODE_SETTABLE_BK:
+        case opcode::HKS_OPCODE_SETTABLE_S:
+        case opcode::HKS_OPCODE_SETTABLE_S_BK:
+        case opcode::HKS_OPCODE_SETLIST:
+            if(std::uint32_t(inst.A) == open.reg) return;
+            break;
+        case opcode::HKS_OPCODE_MOVE:
+        case opcode::HKS_OPCODE_TFORLOOP:
+        case opcode::HKS_OPCODE_DATA:
+            tables_.pop_back();
+            return;
+        default:
+            if(handlers()[inst.OP] == &decompiler::decompile_unknown)
+            {
+                tables_.pop_back();
+                return;
+            }
+            break;
+        }
+
+        auto inline_table = !open.shared && this->fold_target(func, open.reg, index) == open.table &&
+            !live_.reads_after(cfg_, index, open.reg);
+
+        tables_.pop_back();
+
+        if(!inline_table) return;
+
+        block_->stmts.pop_back();
+        func.stack.at(open.reg) = open.table;
+    }
+}
+
+// R(A+1) := R(B); R(A) := R(B)[RK(C)]
+void decompiler::decompile_self(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    auto field_id = lui::child(find_constant(func, inst.C).to_node(arena_));
+    auto obj = lui::child(func.stack.at(inst.B));
+    auto field = arena_.make<lui::node_method>(std::move(obj), std::move(field_id));
+    func.stack.at(inst.A) = field;
+    func.stack.at(inst.A + 1) = arena_.make<lui::node_identifier>("this");
+}
+
+void decompiler::decompile_concat(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto concat = arena_.make<lui::node_concat>();
+
+    for(auto i = inst.B; i <= inst.C; i++)
+    {
+        concat->list.push_back(lui::child(func.stack.at(i)));
+    }
+
+    func.stack.at(inst.A) = concat;
+
+    this->bind(func, index, inst.A);
+}
+
+// ADD to POW_BK alternate register and constant forms in operator order:
+// R(A) := R(B) op RK(C), or K(B) op R(C) for _BK
+void decompiler::decompile_binary(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto offset = std::uint32_t(inst.OP) - std::uint32_t(opcode::HKS_OPCODE_ADD);
+    auto op = lui::binary_op(offset / 2);
+    auto bk = (offset % 2) != 0;
+
+    auto lvalue = bk ? find_constant(func, inst.B).to_literal_node(arena_) : func.stack.at(inst.B);
+    auto rvalue = bk ? func.stack.at(inst.C) : this->rk(func, inst.C, inst.sZero);
+
+    func.stack.at(inst.A) = arena_.make<lui::node_binary>(op, lui::child(lvalue), lui::child(rvalue));
+
+    this->bind(func, index, inst.A);
+}
+
+void decompiler::decompile_unary(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    auto obj = lui::child(func.stack.at(inst.B));
+
+    switch(opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_UNM:
+        func.stack.at(inst.A) = arena_.make<lui::node_unary>(std::move(obj));
+        break;
+    case opcode::HKS_OPCODE_LEN:
+        func.stack.at(inst.A) = arena_.make<lui::node_length>(std::move(obj));
+        break;
+    default:
+        func.stack.at(inst.A) = arena_.make<lui::node_not>(std::move(obj));
+        break;
+    }
+
+    this->bind(func, index, inst.A);
+}
+
+// a compare-and-skip left over by the structuring: prints the condition under
+// which the raw JMP after it is taken. TESTSET also copies R(B) into R(A)
+void decompiler::decompile_test(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    lui::node_ptr cond;
+
+    if(opcode(inst.OP) == opcode::HKS_OPCODE_TESTSET)
+    {
+        auto value = func.stack.at(inst.B);
+        cond = (inst.C != 0) ? value : arena_.make<lui::node_not>(lui::child(value));
+        func.stack.at(inst.A) = value;
+    }
+    else
+    {
+        cond = this->make_condition(func, inst, true);
+    }
+
+    this->emit(lui::child(arena_.make<lui::node_test>(lui::child(cond), false)));
+}
+
+void decompiler::decompile_jump(lui::function&, const lui::instruction& inst, std::uint32_t)
+{
+    auto id = arena_.make<lui::node_identifier>(utils::string::va("LOC_%X", (inst.index + 4 + (inst.sBx * 4))));
+    auto jmp = arena_.make<lui::node_jump>(lui::child(id));
+    raw_labels_.insert(id->value);
+    this->emit(lui::child(jmp));
+}
+
+// C == 0 leaves every result on the stack for the next open call, return or
+// SETLIST, so the call becomes that instruction's last operand
+void decompiler::decompile_call(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    std::int32_t ret_num = inst.C - 1;
+
+    auto call = this->make_call(func, inst);
+
+    if(inst.C == 0)
+    {
+        func.stack.at(inst.A) = call;
+        multret_ = inst.A;
+        return;
+    }
+
+    // results nobody reads make it a plain call statement
+    auto use = (ret_num > 0) ? this->find_use(func, index, inst.A) : liveness::none;
+    auto used = use != liveness::none;
+
+    for(auto i = 1; i < ret_num && !used; i++)
+    {
+        used = this->find_use(func, index, inst.A + i) != liveness::none;
+    }
+
+    if(ret_num == 1 && use != liveness::none && use != liveness::many)
+    {
+        func.stack.at(inst.A) = call;
+        return;
+    }
+
+    if(!used)
+    {
+        this->emit(lui::child(call));
+        return;
+    }
+
+    auto retlist = arena_.make<lui::node_parameters>();
+
+    for(auto i = 0; i < ret_num; i++)
+    {
+        auto var = this->local(index, inst.A + i);
+        func.stack.at(inst.A + i) = var;
+        retlist->list.push_back(lui::child(var));
+    }
+
+    this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(retlist), lui::child(call))));
+}
+
+void decompiler::decompile_tailcall(lui::function& func, const lui::instruction& inst, std::uint32_t )
+{
+    auto ret = arena_.make<lui::node_return>();
+    ret->stmts.push_back(lui::child(this->make_call(func, inst)));
+
+    this->emit(lui::child(ret));
+}
+
+// return R(A), ... ,R(A+B-2). the implicit return closing every function, and
+// the one the compiler puts after a tail call, are left out
+void decompiler::decompile_return(lui::function& func, const lui::instruction& inst, std::uint32_t index)
+{
+    if(index + 1 == func.code.size()) return;
+
+    if(index > 0)
+    {
+        switch(opcode(decode_instruction(func, index - 1).OP))
+        {
+        case opcode::HKS_OPCODE_TAILCALL:
+        case opcode::HKS_OPCODE_TAILCALL_I:
+        case opcode::HKS_OPCODE_TAILCALL_I_R1:
+            return;
+        default:
+            break;
+        }
+    }
+
+    auto ret = arena_.make<lui::node_return>();
+    auto last = (inst.B == 0) ? multret_ + 1 : inst.A + inst.B - 1;
+
+    for(auto i = inst.A; i < last; i++)
+    {
+        ret->stmts.push_back(lui::child(func.stack.at(i)));
+    }
+
+    this->emit(lui::child(ret));
+}
+
+void decompiler::decompile_skip(lui::function&, const lui::instruction&, std::uint32_t)
+{
+}
+
+// a valid opcode without a handler, or one a damaged image made up
+void decompiler::decompile_unknown(lui::function&, const lui::instruction& inst, std::uint32_t)
+{
+    auto name = opcode_name(opcode(inst.OP));
+
+    if (name.empty())
+        this->fail(utils::string::va("opcode 0x%02X at 0x%X can't be decompiled", inst.OP, inst.index));
+    else
+        this->fail(utils::string::va("%s at 0x%X can't be decompiled", name.data(), inst.index));
+}
+
+// where the value written to reg at index is read, if it can be printed
+// there: once, later in the same block, with no statement emitted in between
+// and by an instruction that prints its operands. none when it is never read,
+// many when it needs a local
+auto decompiler::find_use(const lui::function& func, std::uint32_t index, std::uint32_t reg) -> std::uint32_t
+{
+    auto use = live_.single_use(cfg_, index, reg);
+
+    // the first half of a boolean value skips to where the second one falls
+    // through, so the value is read from the block after it
+    if(index > 0 && index + 1 < func.code.size() && opcode(decode_instruction(func, index).OP) == opcode::HKS_OPCODE_LOADBOOL)
+    {
+        auto first = decode_instruction(func, index - 1);
+
+        if(opcode(first.OP) == opcode::HKS_OPCODE_LOADBOOL && first.C != 0 && first.A == reg)
+            use = live_.next_use(cfg_, index + 1, reg);
+    }
+
+    if(use == liveness::none || use == liveness::many) return use;
+    if(this->find_pure_end(func, index + 1, use) != use) return liveness::many;
+
+    auto inst = decode_instruction(func, use);
+
+    switch(opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_MOVE:
+    case opcode::HKS_OPCODE_TFORLOOP:
+    case opcode::HKS_OPCODE_DATA:
+        return liveness::many;
+    case opcode::HKS_OPCODE_RETURN:
+        return (use + 1 < func.code.size()) ? use : liveness::many;
+    default:
+        return (handlers()[inst.OP] != &decompiler::decompile_unknown) ? use : liveness::many;
+    }
+}
+
+// groups the writes of each register that meet at a join, as the writes of a
+// loop counter or of a value picked by a branch do. a forward pass over the
+// cfg carries, per block and register, the group of the write that reaches
+// it and joins the groups arriving from different predecessors. every write
+// of a group of two or more stores to one local instead of being carried as
+// an expression
+void decompiler::find_merged(const lui::function& func)
+{
+    constexpr auto undefined = cfg::none;
+    constexpr auto pass = cfg::none - 1;
+
+    auto registers = func.register_count;
+    auto params = (func.vararg_flags != 2) ? std::min<std::uint32_t>(func.param_count, registers) : 0;
+    auto count = params;
+
+    def_base_.resize(func.code.size());
+
+    for(auto i = 0u; i < func.code.size(); i++)
+    {
+        def_base_[i] = count;
+        count += live_.at(i).def_end - live_.at(i).def_begin;
+    }
+
+    groups_.resize(count);
+    sizes_.assign(count, 1);
+    locals_.assign(count, nullptr);
+    std::iota(groups_.begin(), groups_.end(), 0);
+
+    // parameters are written before the first block
+    for(auto i = 0u; i < params; i++)
+    {
+        locals_[i] = static_cast<lui::identifier_ptr>(func.stack.at(i));
+    }
+
+    // what each block hands on: the last write of a register if it lives
+    // on, undefined when the register is dead or only written conditionally,
+    // pass when the block leaves it alone
+    exports_.assign(cfg_.size() * registers, pass);
+
+    for(auto id = 0u; id < cfg_.size(); id++)
+    {
+        const auto& b = cfg_.at(id);
+        auto* out = &exports_[id * registers];
+
+        for(auto i = b.begin; i < b.end; i++)
+        {
+            const auto& acc = live_.at(i);
+            auto inst = decode_instruction(func, i);
+
+            switch(opcode(inst.OP))
+            {
+            case opcode::HKS_OPCODE_TESTSET:
+                out[inst.A] = undefined;
+                continue;
+            // the first half of a boolean value, the second one stands for both
+            case opcode::HKS_OPCODE_LOADBOOL:
+                if(inst.C != 0 && i + 1 < func.code.size())
+                {
+                    auto next = decode_instruction(func, i + 1);
+
+                    if(opcode(next.OP) == opcode::HKS_OPCODE_LOADBOOL && next.A == inst.A)
+                    {
+                        out[inst.A] = undefined;
+                        continue;
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+
+            for(auto reg = acc.def_begin; reg < acc.def_end; reg++)
+            {
+                out[reg] = def_base_[i] + reg - acc.def_begin;
+            }
+        }
+
+        for(auto reg = 0u; reg < registers; reg++)
+        {
+            if(out[reg] != pass && !live_.live_out(id, reg)) out[reg] = undefined;
+        }
+    }
+
+    reach_.assign(cfg_.size() * registers, undefined);
+
+    for(auto changed = true; changed; )
+    {
+        changed = false;
+
+        for(auto id : cfg_.reverse_postorder())
+        {
+            for(auto reg = 0u; reg < registers; reg++)
+            {
+                auto value = undefined;
+
+                if(live_.live_in(id, reg))
+                {
+                    if(id == 0 && reg < params) value = reg;
+
+                    for(auto pred : cfg_.predecessors(id))
+                    {
+                        auto other = reach_[pred * registers + reg];
+
+                        if(other == undefined) continue;
+                        if(value == undefined) value = other;
+                        else value = this->join(value, other);
+                    }
+                }
+
+                auto out = exports_[id * registers + reg];
+                if(out == pass) out = value;
+
+                auto& old = reach_[id * registers + reg];
+
+                if(out != undefined && (old == undefined || this->find(old) != this->find(out)))
+                {
+                    old = this->find(out);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+auto decompiler::find(std::uint32_t group) -> std::uint32_t
+{
+    while(groups_[group] != group)
+    {
+        groups_[group] = groups_[groups_[group]];
+        group = groups_[group];
+    }
+
+    return group;
+}
+
+auto decompiler::join(std::uint32_t a, std::uint32_t b) -> std::uint32_t
+{
+    a = this->find(a);
+    b = this->find(b);
+
+    if(a == b) return a;
+
+    // parameters stay roots so their name is kept
+    if(b < a) std::swap(a, b);
+
+    groups_[b] = a;
+    sizes_[a] += sizes_[b];
+
+    return a;
+}
+
+// stores the value written to reg at index in its local when the write meets
+// others at a join
+void decompiler::settle(lui::function& func, std::uint32_t index, std::uint32_t reg)
+{
+    if(!this->is_merged(index, reg)) return;
+
+    auto var = this->local(index, reg);
+
+    if(func.stack.at(reg) != var)
+        this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(var), lui::child(func.stack.at(reg)))));
+
+    func.stack.at(reg) = var;
+}
+
+// whether the write to reg at index shares its local with other writes
+auto decompiler::is_merged(std::uint32_t index, std::uint32_t reg) -> bool
+{
+    const auto& acc = live_.at(index);
+
+    if(reg < acc.def_begin || reg >= acc.def_end) return false;
+
+    return sizes_[this->find(def_base_[index] + reg - acc.def_begin)] > 1;
+}
+
+// whether var, copied to reg at index, may be written again while reg is
+// still to be read. the blocks the copy is live through are walked from it
+auto decompiler::is_overwritten(const lui::function& func, std::uint32_t index, std::uint32_t reg,
+    lui::identifier_ptr var) -> bool
+{
+    if(std::find(locals_.begin(), locals_.end(), var) == locals_.end()) return false;
+
+    seen_.assign(cfg_.size(), false);
+    walk_.clear();
+
+    auto id = cfg_.block_of(index);
+    auto from = index + 1;
+
+    while(true)
+    {
+        auto live = true;
+
+        for(auto i = from; live && i < cfg_.at(id).end; i++)
+        {
+            if(this->writes(i, var) && live_.reads_after(cfg_, i, reg)) return true;
+
+            const auto& acc = live_.at(i);
+            auto inst = decode_instruction(func, i);
+
+            // a numeric for keeps its own copy of the start, limit and step
+            if(opcode(inst.OP) == opcode::HKS_OPCODE_FORPREP && reg >= inst.A && reg < inst.A + 3) return false;
+
+            live = reg < acc.def_begin || reg >= acc.def_end;
+        }
+
+        if(live && live_.live_out(id, reg))
+        {
+            for(auto succ : cfg_.successors(id))
+            {
+                if(!seen_[succ]) walk_.push_back(succ);
+                seen_[succ] = true;
+            }
+        }
+
+        if(walk_.empty()) return false;
+
+        id = walk_.back();
+        from = cfg_.at(id).begin;
+        walk_.pop_back();
+    }
+}
+
+// whether the instruction at index stores to the shared local var
+auto decompiler::writes(std::uint32_t index, lui::identifier_ptr var) -> bool
+{
+    const auto& acc = live_.at(index);
+
+    for(auto reg = acc.def_begin; reg < acc.def_end; reg++)
+    {
+        if(this->is_merged(index, reg) && locals_[this->find(def_base_[index] + reg - acc.def_begin)] == var)
+            return true;
+    }
+
+    return false;
+}
+
+// a computed value read more than once, or past another statement, goes to
+// a local so it is neither repeated nor moved
+void decompiler::bind(lui::function& func, std::uint32_t index, std::uint32_t reg)
+{
+    this->settle(func, index, reg);
+
+    if(func.stack.at(reg)->type == lui::node_type::identifier) return;
+    if(this->find_use(func, index, reg) != liveness::many) return;
+
+    auto var = arena_.make<lui::node_identifier>(get_new_variable());
+
+    this->emit(lui::child(arena_.make<lui::node_assign>(lui::child(var), lui::child(func.stack.at(reg)))));
+    func.stack.at(reg) = var;
+}
+
+auto decompiler::local(std::uint32_t index, std::uint32_t reg) -> lui::identifier_ptr
+{
+    const auto& acc = live_.at(index);
+
+    if(reg < acc.def_begin || reg >= acc.def_end)
+        return arena_.make<lui::node_identifier>(get_new_variable());
+
+    auto group = this->find(def_base_[index] + reg - acc.def_begin);
+
+    if(sizes_[group] < 2) return arena_.make<lui::node_identifier>(get_new_variable());
+
+    if(locals_[group] == nullptr) locals_[group] = arena_.make<lui::node_identifier>(get_new_variable());
+
+    return locals_[group];
+}
+
+auto decompiler::make_call(lui::function& func, const lui::instruction& inst) -> lui::call_ptr
+{
+    auto params = arena_.make<lui::node_parameters>();
+    auto name = func.stack.at(inst.A);
+    auto last = (inst.B == 0) ? multret_ : inst.A + inst.B - 1;
+
+    // a method call's first argument is the object SELF put in R(A+1)
+    auto first = (name->type == lui::node_type::method) ? inst.A + 2 : inst.A + 1;
+
+    for(auto i = first; i <= last; i++)
+    {
+        params->list.push_back(lui::child(func.stack.at(i)));
+    }
+
+    auto call = arena_.make<lui::node_call>();
+    call->name = lui::child(name);
+    call->params = lui::child(params);
+
+    return call;
+}
+
+// the key of a field store or load, name tells whether it is a valid name
+auto decompiler::make_key(const lui::function& func, std::int32_t key, bool constant, bool& name) -> lui::node_ptr
+{
+    if(!constant)
+    {
+        auto reg = func.stack.at(key);
+
+        // a name loaded into a register first reads the same as a constant one
+        if(reg->type == lui::node_type::string)
+        {
+            std::string_view value = static_cast<lui::node_string*>(reg)->value;
+            value = value.substr(1, value.size() - 2);
+
+            if(is_name(value))
+            {
+                name = true;
+                return arena_.make<lui::node_identifier>(std::string(value));
+            }
+        }
+
+        name = false;
+        return reg;
+    }
+
+    const auto& k = find_constant(func, key);
+
+    name = k.type_ == lui::data::t::STRING && is_name(k.string_);
+
+    return name ? k.to_node(arena_) : k.to_literal_node(arena_);
+}
+
+auto decompiler::make_index(const lui::function& func, lui::node_ptr obj, std::int32_t key,
+    bool constant) -> lui::node_ptr
+{
+    auto name = false;
+    auto field = this->make_key(func, key, constant, name);
+
+    if(name) return arena_.make<lui::node_field>(lui::child(obj), lui::child(field));
+
+    return arena_.make<lui::node_index>(lui::child(obj), lui::child(field));
+}
+
+auto decompiler::upvalue_name(const lui::function& func, std::uint32_t index) -> std::string
+{
+    if(index < func.upvals.size()) return func.upvals[index];
+
+    return utils::string::va("upval%d", index);
+}
+
+auto decompiler::is_name(std::string_view value) -> bool
+{
+    static const std::unordered_set<std::string_view> keywords =
+    {
+        "and", "break", "do", "else", "elseif", "end", "false", "for", "function", "if", "in",
+        "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while",
+    };
+
+    if(value.empty() || std::isdigit(static_cast<unsigned char>(value[0]))) return false;
+
+    for(auto c : value)
+    {
+        if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+    }
+
+    return keywords.count(value) == 0;
+}
+
+void decompiler::debug_print(const lui::function&, const lui::instruction&)
 {
-    //auto data = utils::string::va("%-14s %s", opcode_name(opcode(inst->OP)).data(), inst->data.data());
-    //auto node = std::make_shared<lui::node_debug>(data);
-    //func.node->block.as_block->stmts.push_back(lui::child(node));
+    //auto data = utils::string::va("%-14s %s", opcode_name(opcode(inst.OP)).data(), inst.data.data());
+    //auto node = arena_.make<lui::node_debug>(data);
+    //this->emit(lui::child(node));
 }
 
-auto decompiler::find_constant(const lui::function& func, std::int32_t index) -> lui::kst
+auto decompiler::find_constant(const lui::function& func, std::int32_t index) -> const lui::kst&
 {
     if (index < 0) index = -index;
 
@@ -11,20 +11,129 @@ namespace IW6
 
 class decompiler : public lui::decompiler
 {
+    using handler = void (decompiler::*)(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+
+    // a compare-and-skip instruction and the target of the JMP after it
+    struct cond_pair
+    {
+        std::uint32_t test;
+        std::uint32_t target;
+    };
+
+    // a table NEWTABLE assigned to a local, the last instruction folded into
+    // its constructor, and whether the local is shared with other writes
+    struct open_table
+    {
+        lui::newtable_ptr table;
+        std::uint32_t reg;
+        std::uint32_t end;
+        bool shared;
+    };
+
     lui::file_ptr file_;
+    utils::arena arena_;
     lui::script_ptr script_;
+    lui::block_ptr block_;
     std::int32_t var_index;
+    std::uint32_t loop_exit_;
+    std::uint32_t loop_head_;
+    std::uint32_t multret_;
+    std::vector<std::uint32_t> follow_;
+    std::size_t follow_base_;
+    cfg cfg_;
+    liveness live_;
+    std::vector<std::uint32_t> def_base_;
+    std::vector<std::uint32_t> groups_;
+    std::vector<std::uint32_t> sizes_;
+    std::vector<std::uint32_t> exports_;
+    std::vector<std::uint32_t> reach_;
+    std::vector<std::uint32_t> walk_;
+    std::vector<bool> seen_;
+    std::vector<lui::identifier_ptr> locals_;
+    std::vector<cond_pair> chain_;
+    std::vector<open_table> tables_;
+    std::unordered_set<std::string> raw_labels_;
+    std::string error_;
+
+    friend class bench;
 
 public:
     auto output() -> std::vector<std::uint8_t>;
-    void decompile(lui::file_ptr file);
+    auto decompile(lui::file_ptr file) -> bool;
+    auto error() -> const std::string&;
 
 private:
+    void fail(std::string message);
     void decompile_function(lui::function& func);
+    void decompile_range(lui::function& func, std::uint32_t begin, std::uint32_t end);
+    auto decompile_statement(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto decompile_loop(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto decompile_if(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto decompile_for(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto decompile_for_in(lui::function& func, std::uint32_t index, lui::node_ptr call) -> std::uint32_t;
+    auto decompile_block(lui::function& func, std::uint32_t begin, std::uint32_t end, std::uint32_t exit,
+        std::uint32_t follow) -> lui::block_ptr;
+    auto is_follow(std::int64_t index) -> bool;
+    auto decompile_boolean(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto find_boolean(const lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto decompile_logical(lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto find_last(const lui::function& func, std::uint32_t begin, std::uint32_t end) -> std::uint32_t;
+    auto is_expression(const lui::function& func, std::uint32_t begin, std::uint32_t end, std::uint32_t reg) -> bool;
+    static auto handlers() -> const std::array<handler, 128>&;
     void decompile_instruction(lui::function& func,  std::uint32_t& index);
-    auto decompile_call(lui::function& func, const lui::instruction_ptr& inst) -> lui::child;
-    auto find_constant(const lui::function& func, std::int32_t index) -> lui::kst;
-    void debug_print(const lui::function& func, const lui::instruction_ptr& inst);
+    void decompile_getfield(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_setfield(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_getglobal(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_setglobal(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_getupval(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_setupval(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_move(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_loadk(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_loadbool(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_loadnil(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_vararg(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_closure(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_newtable(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_setlist(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    auto fold_target(const lui::function& func, std::uint32_t reg, std::uint32_t index) -> lui::newtable_ptr;
+    void close_table(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_self(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_concat(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_binary(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_unary(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_test(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_jump(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_call(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_tailcall(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_return(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_skip(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    void decompile_unknown(lui::function& func, const lui::instruction& inst, std::uint32_t index);
+    auto find_use(const lui::function& func, std::uint32_t index, std::uint32_t reg) -> std::uint32_t;
+    void find_merged(const lui::function& func);
+    auto find(std::uint32_t group) -> std::uint32_t;
+    auto join(std::uint32_t a, std::uint32_t b) -> std::uint32_t;
+    void settle(lui::function& func, std::uint32_t index, std::uint32_t reg);
+    auto is_merged(std::uint32_t index, std::uint32_t reg) -> bool;
+    auto is_overwritten(const lui::function& func, std::uint32_t index, std::uint32_t reg,
+        lui::identifier_ptr var) -> bool;
+    auto writes(std::uint32_t index, lui::identifier_ptr var) -> bool;
+    void bind(lui::function& func, std::uint32_t index, std::uint32_t reg);
+    auto local(std::uint32_t index, std::uint32_t reg) -> lui::identifier_ptr;
+    auto make_call(lui::function& func, const lui::instruction& inst) -> lui::call_ptr;
+    auto make_key(const lui::function& func, std::int32_t key, bool constant, bool& name) -> lui::node_ptr;
+    auto make_index(const lui::function& func, lui::node_ptr obj, std::int32_t key, bool constant) -> lui::node_ptr;
+    auto upvalue_name(const lui::function& func, std::uint32_t index) -> std::string;
+    static auto is_name(std::string_view value) -> bool;
+    auto make_condition(lui::function& func, const lui::instruction& inst, bool negate) -> lui::node_ptr;
+    auto build_condition(lui::function& func, std::uint32_t begin, bool negate = false) -> lui::node_ptr;
+    auto find_chain(const lui::function& func, std::uint32_t index, std::uint32_t end, std::uint32_t exit) -> bool;
+    auto find_pure_end(const lui::function& func, std::uint32_t index, std::uint32_t end) -> std::uint32_t;
+    auto find_for_in(const lui::function& func, std::uint32_t index, std::uint32_t end) -> bool;
+    auto rk(const lui::function& func, std::int32_t index, bool zero) -> lui::node_ptr;
+    void emit(lui::child stmt);
+    void prune_labels(lui::block_ptr block);
+    auto find_constant(const lui::function& func, std::int32_t index) -> const lui::kst&;
+    void debug_print(const lui::function& func, const lui::instruction& inst);
     auto get_new_variable() -> std::string;
 };
 
@@ -8,25 +8,19 @@
 namespace IW6
 {
 
-int disassembler::tabsize_ = 0;
+disassembler::disassembler() {}
 
-std::string indented(std::uint32_t indent)
-{
-    static char buff[100];
-    snprintf(buff, sizeof(buff), "%*s", indent, "");
-    return std::string(buff);
-}
+disassembler::disassembler(utils::string_pool_ptr strings) : strings_(std::move(strings)) {}
 
 auto disassembler::output() -> std::vector<std::uint8_t>
 {
-    print_function(file_->main);
+    // listings run about six times the size of the bytecode
+    output_.reserve(buffer_->size() * 6);
 
-    std::vector<std::uint8_t> output;
+    tabsize_ = 0;
+    print_function(file_->main);
 
-    output.resize(output_->pos());
-    std::memcpy(output.data(), output_->buffer().data(), output.size());
-    
-    return output;
+    return output_.release();
 }
 
 auto disassembler::output_d() -> lui::file_ptr
@@ -34,36 +28,67 @@ auto disassembler::output_d() -> lui::file_ptr
     return std::move(file_);
 }
 
-void disassembler::disassemble(std::vector<std::uint8_t>& data)
+auto disassembler::disassemble(std::vector<std::uint8_t>& data) -> bool
 {
-    output_ = std::make_unique<utils::byte_buffer>(0x1000000);
-    buffer_ = std::make_unique<utils::byte_buffer>(data);
+    return this->disassemble(data.data(), data.size());
+}
+
+auto disassembler::disassemble(const std::uint8_t* data, std::size_t size) -> bool
+{
+    output_.clear();
+    buffer_ = std::make_unique<utils::byte_view>(data, size);
     file_ = std::make_unique<lui::file>();
+    file_->strings = (strings_ != nullptr) ? strings_ : std::make_shared<utils::string_pool>();
 
     disassemble_header();
     disassemble_functions();
     disassemble_prototype();
+
+    if (buffer_->failed()) return false;
+
+    disassemble_fields(file_->main);
+
+    return !buffer_->failed();
+}
+
+auto disassembler::error() -> const std::string&
+{
+    return buffer_->error();
 }
 
 void disassembler::disassemble_header()
 {
-    file_->header.magic = buffer_->read<std::uint32_t>();
-    file_->header.lua_version = buffer_->read<std::uint8_t>();
-    file_->header.format_version = buffer_->read<std::uint8_t>();
-    file_->header.endianness = buffer_->read<std::uint8_t>();
-    file_->header.size_of_int = buffer_->read<std::uint8_t>();
-    file_->header.size_of_size_t = buffer_->read<std::uint8_t>();
-    file_->header.size_of_intruction = buffer_->read<std::uint8_t>();
-    file_->header.size_of_lua_number = buffer_->read<std::uint8_t>();
-    file_->header.integral_flag = buffer_->read<std::uint8_t>();
-    file_->header.build_flags = buffer_->read<std::uint8_t>();
-    file_->header.referenced_mode = buffer_->read<std::uint8_t>();
-    file_->header.type_count = buffer_->read<std::uint32_t>();
-
-    for(auto i = 0; i < file_->header.type_count; i++)
+    if (!buffer_->require(header_size)) return;
+
+    file_->header.magic = buffer_->read_unchecked<std::uint32_t>();
+    file_->header.lua_version = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.format_version = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.endianness = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.size_of_int = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.size_of_size_t = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.size_of_intruction = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.size_of_lua_number = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.integral_flag = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.build_flags = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.referenced_mode = buffer_->read_unchecked<std::uint8_t>();
+    file_->header.type_count = buffer_->read_unchecked<std::uint32_t>();
+
+    if (file_->header.magic != 0x61754C1B)
+    {
+        buffer_->fail(utils::string::va("bad signature 0x%08X", file_->header.magic));
+        return;
+    }
+
+    if (file_->header.type_count > buffer_->remaining() / type_size)
+    {
+        buffer_->fail(utils::string::va("%u types past the end", file_->header.type_count));
+        return;
+    }
+
+    for (auto i = 0u; i < file_->header.type_count && !buffer_->failed(); i++)
     {
         auto id = buffer_->read<std::uint32_t>();
-        auto length = buffer_->read<std::uint32_t>();
+        buffer_->read<std::uint32_t>(); // name length, the string is read to its terminator
         auto name = buffer_->read_string();
 
         file_->header.types.push_back(lui::type_info(id, name));
@@ -73,459 +98,751 @@ void disassembler::disassemble_header()
 void disassembler::disassemble_functions()
 {
     file_->main = lui::function();
-    this->disassemble_function(file_->main);
+    this->disassemble_function(file_->main, 0);
 }
 
 void disassembler::disassemble_prototype()
 {
-    auto head_mismatch = buffer_->read<std::uint32_t>();
-    auto unk1 = buffer_->read<std::uint32_t>();
-    auto unk2 = buffer_->read<std::uint32_t>();
+    if (!buffer_->require(12)) return;
+
+    file_->prototype.head_mismatch = buffer_->read_unchecked<std::uint32_t>();
+    file_->prototype.unk1 = buffer_->read_unchecked<std::uint32_t>();
+    file_->prototype.unk2 = buffer_->read_unchecked<std::uint32_t>();
 }
 
-void disassembler::disassemble_function(lui::function& func)
+void disassembler::disassemble_function(lui::function& func, std::uint32_t depth)
 {
     if(buffer_->pos() == 0xEE)
         func.name = "_init_";
     else
         func.name = utils::string::va("_func_%X", buffer_->pos());
 
-    func.upval_count = buffer_->read<std::uint32_t>();
-    func.param_count = buffer_->read<std::uint32_t>();
-    func.vararg_flags = buffer_->read<std::uint8_t>();
-    func.register_count = buffer_->read<std::uint32_t>();
-    func.instruction_count = buffer_->read<std::uint64_t>();
-    func.instructions.reserve(func.instruction_count);
+    if (depth > max_depth)
+    {
+        buffer_->fail(utils::string::va("functions nested deeper than %u at 0x%zX", max_depth, buffer_->pos()));
+        return;
+    }
+
+    if (!buffer_->require(function_size)) return;
+
+    func.upval_count = buffer_->read_unchecked<std::uint32_t>();
+    func.param_count = buffer_->read_unchecked<std::uint32_t>();
+    func.vararg_flags = buffer_->read_unchecked<std::uint8_t>();
+    func.register_count = buffer_->read_unchecked<std::uint32_t>();
+    func.instruction_count = buffer_->read_unchecked<std::uint64_t>();
+
+    // registers and upvalues are addressed by 8 bit operands, parameters are
+    // the first registers
+    if (func.register_count > max_registers || func.param_count > func.register_count ||
+        func.upval_count > max_registers)
+    {
+        buffer_->fail(utils::string::va("%s has %u registers, %u parameters and %u upvalues", func.name.data(),
+            func.register_count, func.param_count, func.upval_count));
+        return;
+    }
 
     // always a byte here 0x5F
     int pad = 4 - (int)buffer_->pos() % 4;
     if (pad > 0 && pad < 4) buffer_->seek(pad);
 
-    for (auto i = 0; i < func.instruction_count; i++)
+    this->disassemble_instructions(func);
+
+    func.constant_count = buffer_->read<std::uint32_t>();
+
+    // every constant takes a byte at least, a larger count can't be right
+    if (func.constant_count > buffer_->remaining())
     {
-        this->disassemble_instruction(func);
+        buffer_->fail(utils::string::va("%u constants past the end in %s", func.constant_count, func.name.data()));
+        return;
     }
 
-    func.constant_count = buffer_->read<std::uint32_t>();
     func.constants.reserve(func.constant_count);
 
-    for (auto i = 0; i < func.constant_count; i++)
+    for (auto i = 0u; i < func.constant_count && !buffer_->failed(); i++)
     {
         this->disassemble_constant(func);
     }
 
     func.debug = buffer_->read<std::uint32_t>();
     func.sub_func_count = buffer_->read<std::uint32_t>();
-    func.sub_funcs.reserve(func.sub_func_count);
 
-    for (auto i = 0; i < func.sub_func_count; i++)
+    if (func.sub_func_count > buffer_->remaining() / function_size)
     {
-        func.sub_funcs.push_back(lui::function());
-        this->disassemble_function(func.sub_funcs.back());
+        buffer_->fail(utils::string::va("%u functions past the end in %s", func.sub_func_count, func.name.data()));
+        return;
     }
 
-    for (auto i = 0; i < func.instruction_count; i++)
+    func.sub_funcs.reserve(func.sub_func_count);
+
+    for (auto i = 0u; i < func.sub_func_count && !buffer_->failed(); i++)
     {
-        this->disassemble_fields(func, i);
+        func.sub_funcs.push_back(lui::function());
+        this->disassemble_function(func.sub_funcs.back(), depth + 1);
     }
 }
 
-void disassembler::disassemble_instruction(lui::function& func)
+void disassembler::disassemble_instructions(lui::function& func)
 {
-    auto index = buffer_->pos();
-    auto value = buffer_->read<std::uint32_t>();
-
-    auto OP = (std::uint8_t)((value & MASK_OP) >> POS_OP);
-    auto A  = (std::int32_t)((value & MASK_A) >> POS_A);
-    auto C  = (std::int32_t)((value & MASK_C) >> POS_C);
-    auto B  = (std::int32_t)((value & MASK_B) >> POS_B);
-    auto Bx = (std::int32_t)((value & MASK_Bx) >> POS_Bx);
-    auto sBx = (std::int32_t)(Bx - 0x10000 + 1);
-    bool sZero = false;
-    if (C >= 0x100) { C -= 0x100; sZero = true; }
-
-    auto inst = std::make_unique<lui::instruction>(index, value, OP, A, B, C, Bx, sBx, sZero);
-    func.instructions.push_back(std::move(inst));
+    func.code_offset = buffer_->pos();
+    buffer_->read_array(func.code, func.instruction_count);
+
+    auto index = find_invalid_opcode(func.code.data(), func.code.size());
+
+    if (index != func.code.size())
+    {
+        buffer_->fail(utils::string::va("unknown opcode 0x%02X at 0x%zX", func.code[index] >> POS_OP,
+            func.code_offset + index * 4));
+    }
 }
 
 void disassembler::disassemble_constant(lui::function& func)
 {
-    std::string value;
     auto type = lui::data::t(buffer_->read<std::uint8_t>());
 
     switch(type)
     {
         case lui::data::t::NIL:
-            value = "nil";
+            func.constants.push_back(lui::kst::nil());
         break;
         case lui::data::t::BOOLEAN:
-            value = ((bool)buffer_->read<std::uint8_t>()) ? "true" : "false";
+            func.constants.push_back(lui::kst::boolean(buffer_->read<std::uint8_t>() != 0));
         break;
         /*case lui::data::t::LIGHTUSERDATA:
             value = utils::string::va("%lld", buffer_->read<std::uint64_t>());
         break;*/
         case lui::data::t::NUMBER:
-            value = utils::string::va("%g", buffer_->read<float>());
+            func.constants.push_back(lui::kst::number(buffer_->read<float>()));
         break;
         case lui::data::t::STRING:
             buffer_->read<std::uint64_t>();
-            value = buffer_->read_string();
+            func.constants.push_back(lui::kst::string(file_->strings->intern(buffer_->read_string_view())));
         break;
         default:
-            DISASSEMBLER_ERROR("UNKNOWN CONSTANT TYPE");
+            buffer_->fail(utils::string::va("unknown constant type %u at 0x%zX", std::uint32_t(type), buffer_->pos() - 1));
         break;
     }
+}
 
-    func.constants.push_back(lui::kst(type, value));
+// operand text is produced while printing, here only jump targets are resolved
+// and the operands everything after indexes with are checked
+void disassembler::disassemble_fields(lui::function& func)
+{
+    for (auto& sub : func.sub_funcs)
+    {
+        this->disassemble_fields(sub);
+    }
+
+    for (auto i = 0u; i < func.code.size() && !buffer_->failed(); i++)
+    {
+        auto inst = decode_instruction(func, i);
+
+        this->check_operands(func, inst);
+
+        if (opcode(inst.OP) == opcode::HKS_OPCODE_JMP)
+        {
+            auto loc = std::uint32_t(inst.index + 4 + (inst.sBx * 4));
+            func.labels.insert({ loc, utils::string::va("LOC_%X", loc) });
+        }
+    }
 }
 
-void disassembler::disassemble_fields(lui::function& func, std::uint32_t index)
+// registers, constants, functions and jump targets an instruction refers to
+// must be in its function
+void disassembler::check_operands(const lui::function& func, const lui::instruction& inst)
 {
-    auto& inst = func.instructions.at(index);
-    auto op = opcode(inst->OP);
+    liveness::access acc;
+    liveness::operands(inst, func.register_count, acc);
+
+    // a for loop also writes its variable, R(A+3)
+    if (opcode(inst.OP) == opcode::HKS_OPCODE_FORPREP || opcode(inst.OP) == opcode::HKS_OPCODE_FORLOOP)
+    {
+        acc.def_end = inst.A + 4;
+    }
+
+    auto bad = std::max(acc.def_begin, acc.def_end) > func.register_count ||
+        std::max(acc.use_begin, acc.use_end) > func.register_count;
+
+    // a call's run starts at the function called, which is read even when
+    // it passes everything up to the stack top
+    switch (opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_CALL:
+    case opcode::HKS_OPCODE_CALL_I:
+    case opcode::HKS_OPCODE_CALL_I_R1:
+    case opcode::HKS_OPCODE_TAILCALL:
+    case opcode::HKS_OPCODE_TAILCALL_I:
+    case opcode::HKS_OPCODE_TAILCALL_I_R1:
+        bad = bad || inst.A >= func.register_count;
+        break;
+    default:
+        break;
+    }
+
+    for (auto i = 0u; i < acc.use_count; i++)
+    {
+        bad = bad || acc.uses[i] >= func.register_count;
+    }
+
+    if (bad)
+    {
+        buffer_->fail(utils::string::va("%s at 0x%X uses a register past %u", opcode_name(opcode(inst.OP)).data(),
+            inst.index, func.register_count));
+        return;
+    }
+
+    auto constant = [&](std::uint32_t index)
+    {
+        if (index < func.constants.size()) return;
+
+        buffer_->fail(utils::string::va("%s at 0x%X reads constant %u of %zu", opcode_name(opcode(inst.OP)).data(),
+            inst.index, index, func.constants.size()));
+    };
+
+    auto rk = [&] { if (inst.sZero) constant(inst.C); };
+
+    switch (opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_GETFIELD:
+    case opcode::HKS_OPCODE_GETFIELD_R1:
+        constant(inst.C);
+        break;
+    case opcode::HKS_OPCODE_EQ_BK:
+    case opcode::HKS_OPCODE_ADD_BK:
+    case opcode::HKS_OPCODE_SUB_BK:
+    case opcode::HKS_OPCODE_MUL_BK:
+    case opcode::HKS_OPCODE_DIV_BK:
+    case opcode::HKS_OPCODE_MOD_BK:
+    case opcode::HKS_OPCODE_POW_BK:
+    case opcode::HKS_OPCODE_LT_BK:
+    case opcode::HKS_OPCODE_LE_BK:
+        constant(inst.B);
+        break;
+    case opcode::HKS_OPCODE_SETFIELD:
+    case opcode::HKS_OPCODE_SETFIELD_R1:
+    case opcode::HKS_OPCODE_SETTABLE_S_BK:
+    case opcode::HKS_OPCODE_SETTABLE_BK:
+        constant(inst.B);
+        rk();
+        break;
+    case opcode::HKS_OPCODE_EQ:
+    case opcode::HKS_OPCODE_SELF:
+    case opcode::HKS_OPCODE_GETTABLE_S:
+    case opcode::HKS_OPCODE_GETTABLE:
+    case opcode::HKS_OPCODE_SETTABLE_S:
+    case opcode::HKS_OPCODE_SETTABLE:
+    case opcode::HKS_OPCODE_ADD:
+    case opcode::HKS_OPCODE_SUB:
+    case opcode::HKS_OPCODE_MUL:
+    case opcode::HKS_OPCODE_DIV:
+    case opcode::HKS_OPCODE_MOD:
+    case opcode::HKS_OPCODE_POW:
+    case opcode::HKS_OPCODE_LT:
+    case opcode::HKS_OPCODE_LE:
+        rk();
+        break;
+    case opcode::HKS_OPCODE_GETGLOBAL:
+    case opcode::HKS_OPCODE_GETGLOBAL_MEM:
+    case opcode::HKS_OPCODE_SETGLOBAL:
+    case opcode::HKS_OPCODE_LOADK:
+        constant(inst.Bx);
+        break;
+    case opcode::HKS_OPCODE_DATA:
+        if (inst.A == 20) constant(inst.Bx);
+        break;
+    case opcode::HKS_OPCODE_CLOSURE:
+        if (inst.Bx >= func.sub_funcs.size())
+        {
+            buffer_->fail(utils::string::va("CLOSURE at 0x%X makes function %u of %zu", inst.index, inst.Bx,
+                func.sub_funcs.size()));
+        }
+        break;
+    case opcode::HKS_OPCODE_JMP:
+    case opcode::HKS_OPCODE_FORPREP:
+    case opcode::HKS_OPCODE_FORLOOP:
+    {
+        auto target = std::int64_t(inst.index) + 4 + std::int64_t(inst.sBx) * 4;
+        auto end = std::int64_t(func.code_offset) + std::int64_t(func.code.size()) * 4;
+
+        if (target < func.code_offset || target >= end)
+        {
+            buffer_->fail(utils::string::va("%s at 0x%X jumps out of its function", opcode_name(opcode(inst.OP)).data(),
+                inst.index));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-#define RK(f, c, z) (c < 0 || z) ? std::string(find_constant(f, c).print()) : std::string(lui::reg(c).print());
+void disassembler::print_fields(const lui::function& func, const lui::instruction& inst)
+{
+    auto op = opcode(inst.OP);
+    auto C = inst.C | (inst.sZero ? 0x100 : 0); // C as encoded, for non RK operands
                                                     // -------------------------------------
     switch(op)                                      // args    description
     {                                               // -------------------------------------
     case opcode::HKS_OPCODE_GETFIELD:               // A B C   R(A) := R(B)[K(C)]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += find_constant(func, inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_constant(func, inst.C);
         break;
     case opcode::HKS_OPCODE_TEST:                   // A C     if not (R(A) <=> C) then pc++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("BOOL(%d)", inst->C); // && use 0, || use 1                 
+        print_register(inst.A); output_.write(", ");
+        print_number("BOOL", C); // && use 0, || use 1                 
         break;
     case opcode::HKS_OPCODE_CALL_I:                 // A B C   ?
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B) += ", "; // last_arg + 1
-        inst->data += utils::string::va("RET(%02X)", inst->C); // last_ret + 1
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); output_.write(", "); // last_arg + 1
+        print_operand("RET", C); // last_ret + 1
         break;
     case opcode::HKS_OPCODE_EQ:                     // A B C   if ((R(B) == RK(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_EQ_BK:                  // A B C   if ((K(B) == R(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_GETGLOBAL:              // A Bx    R(A) := Gbl[Kst(Bx)] 
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->Bx).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.Bx);
         break;
     case opcode::HKS_OPCODE_MOVE:                   // A B     R(A) := R(B)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B);
         break;
     case opcode::HKS_OPCODE_SELF:                   // A B C   R(A+1) := R(B); R(A) := R(B)[RK(C)]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_RETURN:                 // A B    return R(A), ... ,R(A+B-2)
-        inst->data += lui::reg(inst->A).print() += ", "; // if B == 1, no rets. B == 0, R(A) to stack top
-        inst->data += utils::string::va("OPT(%02X)", inst->B); // if B >= 2,  (B-1) returns
+        print_register(inst.A); output_.write(", "); // if B == 1, no rets. B == 0, R(A) to stack top
+        print_operand("OPT", inst.B); // if B >= 2,  (B-1) returns
         break;
     case opcode::HKS_OPCODE_GETTABLE_S:             // A B C   R(A) := R(B)[RK(C)]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_GETTABLE:               // A B C   R(A) := R(B)[RK(C)]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_LOADBOOL:               // A B C   R(A) := (Bool)B; if (C) pc++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("BOOL(%d)", inst->B) += ", ";
-        inst->data += utils::string::va("BOOL(%d)", inst->C);
+        print_register(inst.A); output_.write(", ");
+        print_number("BOOL", inst.B); output_.write(", ");
+        print_number("BOOL", C);
         break;
     case opcode::HKS_OPCODE_TFORLOOP:               // A C    3 internal vars, and user vars in R(A+3) to C
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("NUM(%02X)", inst->C);
+        print_register(inst.A); output_.write(", ");
+        print_operand("NUM", C);
         break;
     case opcode::HKS_OPCODE_SETFIELD:               // A B C   R(A)[K(B)] := RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_SETTABLE_S:             // A B C   R(A)[R(B)] := RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_SETTABLE_S_BK:          // A B C   R(A)[K(B)] := RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_SETTABLE:               // A B C   R(A)[R(B)] := RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_SETTABLE_BK:            // A B C   R(A)[K(B)] := RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_TAILCALL_I:             // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B); // last_arg + 1 // C always 0
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); // last_arg + 1 // C always 0
         break;
     case opcode::HKS_OPCODE_LOADK:                  // A Bx    R(A) := Kst(Bx)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        {
-            auto kst = find_constant(func, inst->Bx);
-            if(kst.data_.type_ == lui::data::t::STRING)
-                kst.data_.to_literal();
-            inst->data += kst.print();
-        }
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.Bx);
         break;
     case opcode::HKS_OPCODE_LOADNIL:                // A B     R(A) := ... := R(B) := nil
-        inst->data += utils::string::va("R(%02X .. %02X)", inst->A, inst->B);
+        print_range(inst.A, inst.B);
         break;
     case opcode::HKS_OPCODE_SETGLOBAL:              // A Bx    Gbl[Kst(Bx)] := R(A)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->Bx).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.Bx);
         break;
     case opcode::HKS_OPCODE_JMP:                    // sBx      pc += sBx
-    {
-        auto loc = std::int32_t(inst->index + 4 + (inst->sBx * 4));
-        func.labels.insert({ loc, utils::string::va("LOC_%X", loc)});
-        inst->data += utils::string::va("LOC_%X", loc);
-    }
+        output_.write(func.labels.at(inst.index + 4 + (inst.sBx * 4)));
         break;
     case opcode::HKS_OPCODE_CALL:                   // A B C   ?
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B) += ", "; // last_arg + 1
-        inst->data += utils::string::va("RET(%02X)", inst->C); // last_ret + 1
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); output_.write(", "); // last_arg + 1
+        print_operand("RET", C); // last_ret + 1
         break;
     case opcode::HKS_OPCODE_TAILCALL:               // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B); // last_arg + 1 // C always 0
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); // last_arg + 1 // C always 0
         break;
     case opcode::HKS_OPCODE_GETUPVAL:               // A B      R(A) := UpValue[B]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("UPVAL(%02X)", inst->B);
+        print_register(inst.A); output_.write(", ");
+        print_operand("UPVAL", inst.B);
         break;
     case opcode::HKS_OPCODE_SETUPVAL:               // A B      UpValue[B] := R(A)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("UPVAL(%02X)", inst->B);
+        print_register(inst.A); output_.write(", ");
+        print_operand("UPVAL", inst.B);
         break;
     case opcode::HKS_OPCODE_ADD:                    // A B C   R(A) := R(B) + RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_ADD_BK:                 // A B C   R(A) := K(B) + R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_SUB:                    //  A B C   R(A) := R(B) – RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_SUB_BK:                 //  A B C   R(A) := K(B) – R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_MUL:                    //  A B C   R(A) := R(B) * RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_MUL_BK:                 //  A B C   R(A) := K(B) * R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_DIV:                    // A B C   R(A) := R(B) / RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_DIV_BK:                 // A B C   R(A) := K(B) / R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_MOD:                    // A B C   R(A) := R(B) % RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_MOD_BK:                 // A B C   R(A) := K(B) % R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_POW:                    // A B C   R(A) := R(B) ^ RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_POW_BK:                 // A B C   R(A) := K(B) ^ R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_NEWTABLE:               // A B C   R(A) := array=B hash=C
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("IDX(%02X), ", inst->B);
-        inst->data += utils::string::va("HASH(%02X)", inst->C);
+        print_register(inst.A); output_.write(", ");
+        print_operand("IDX", inst.B); output_.write(", ");
+        print_operand("HASH", C);
         break;
     case opcode::HKS_OPCODE_UNM:                    // A B     R(A) := -R(B)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B);
         break;
     case opcode::HKS_OPCODE_NOT:                    // A B     R(A) := not R(B)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B);
         break;
     case opcode::HKS_OPCODE_LEN:                    // A B     R(A) := length of R(B)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B);
         break;
     case opcode::HKS_OPCODE_LT:                     // A B C   if ((R(B) < RK(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_LT_BK:                  // A B C   if ((K(B) < R(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_LE:                     //  A B C if ((R(B) <= RK(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_LE_BK:                  //  A B C if ((K(B) <= R(C)) ~= A) then PC++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += lui::reg(inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_register(inst.C);
         break;
     case opcode::HKS_OPCODE_CONCAT:                 // A B C   R(A) := R(B).. ... ..R(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("R(%02X .. %02X)", inst->B, inst->C);
+        print_register(inst.A); output_.write(", ");
+        print_range(inst.B, C);
         break;
     case opcode::HKS_OPCODE_TESTSET:                // A B C   if (R(B) <=> C) then R(A) := R(B) else pc++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += utils::string::va("BOOL(%d)", inst->C); // && use 0, || use 1
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_number("BOOL", C); // && use 0, || use 1
         break;
     case opcode::HKS_OPCODE_FORPREP:                // A sBx   R(A) -= R(A+2); PC += sBx
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("PC(%d)", inst->sBx);
+        print_register(inst.A); output_.write(", ");
+        print_number("PC", inst.sBx);
         break;
     case opcode::HKS_OPCODE_FORLOOP:                // A sBx   R(A) += R(A+2) if R(A) <?= R(A+1) then { PC += sBx; R(A+3) = R(A) }
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("PC(%d)", inst->sBx);
+        print_register(inst.A); output_.write(", ");
+        print_number("PC", inst.sBx);
         break;
     case opcode::HKS_OPCODE_SETLIST:                // A B C   R(A)[(C-1)*FPF+i] := R(A+i), 1 <= i <= B
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("R(%02X .. %02X)", inst->C, inst->B); // regs(C, B), for B < 50
+        print_register(inst.A); output_.write(", ");
+        print_range(C, inst.B); // regs(C, B), for B < 50
         break;
     case opcode::HKS_OPCODE_CLOSE:                  // A       close all variables in the stack up to (>=) R(A)
-        inst->data += lui::reg(inst->A).print();
+        print_register(inst.A);
         break;
     case opcode::HKS_OPCODE_CLOSURE:                // A Bx    R(A) := closure(KPROTO[Bx], R(A), ... ,R(A+n))
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("FUN(%02X)", inst->Bx);
+        print_register(inst.A); output_.write(", ");
+        print_operand("FUN", inst.Bx);
         break;
     case opcode::HKS_OPCODE_VARARG:                 // A B     R(A), R(A+1), ..., R(A+B-1) = vararg
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("NUM(%02X)", inst->B);
+        print_register(inst.A); output_.write(", ");
+        print_operand("NUM", inst.B);
         break;
     case opcode::HKS_OPCODE_TAILCALL_I_R1:          // A B C   return R(A)(R(A+1), ... ,R(A+B-1))
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B); // last_arg + 1 // C always 0
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); // last_arg + 1 // C always 0
         break;
     case opcode::HKS_OPCODE_CALL_I_R1:              // A B C   ?
-        inst->data += lui::reg(inst->A).print() += ", "; // call pointer
-        inst->data += utils::string::va("ARG(%02X)", inst->B) + ", "; // last_arg + 1
-        inst->data += utils::string::va("RET(%02X)", inst->C); // last_ret + 1
+        print_register(inst.A); output_.write(", "); // call pointer
+        print_operand("ARG", inst.B); output_.write(", "); // last_arg + 1
+        print_operand("RET", C); // last_ret + 1
         break;
     case opcode::HKS_OPCODE_SETUPVAL_R1:            // A B      UpValue[B] := R(A)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("UPVAL(%02X)",inst->B);
+        print_register(inst.A); output_.write(", ");
+        print_operand("UPVAL", inst.B);
         break;
     case opcode::HKS_OPCODE_TEST_R1:                // A C     if not (R(A) <=> C) then pc++
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += utils::string::va("BOOL(%d)", inst->C); // && use 0, || use 1
+        print_register(inst.A); output_.write(", ");
+        print_number("BOOL", C); // && use 0, || use 1
         break;
     case opcode::HKS_OPCODE_NOT_R1:                 // A B     R(A) := not R(B)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B);
         break;
     case opcode::HKS_OPCODE_GETFIELD_R1:            // A B C   R(A) = R(B)[K(C)]
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += lui::reg(inst->B).print() += ", ";
-        inst->data += find_constant(func, inst->C).print();
+        print_register(inst.A); output_.write(", ");
+        print_register(inst.B); output_.write(", ");
+        print_constant(func, inst.C);
         break;
     case opcode::HKS_OPCODE_SETFIELD_R1:            // A B C   R(A)[K(B)] = RK(C)
-        inst->data += lui::reg(inst->A).print() += ", ";
-        inst->data += find_constant(func, inst->B).print() += ", ";
-        inst->data += RK(func, inst->C, inst->sZero);
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.B); output_.write(", ");
+        print_rk(func, inst.C, inst.sZero);
         break;
     case opcode::HKS_OPCODE_DATA:                   // A Bx    ????
 // This not exits in vm executer!!! is parsed before??
 // if A == 00, Bx is 0 
 // if A == 20, Bx is a constant(nil)
-//      inst->mode = lui::instruction_mode::ABx;
-      inst->data += utils::string::va("OPT(%02X)", inst->A) + ", ";
-      inst->data += (inst->A == 20) ? find_constant(func, inst->Bx).print() : utils::string::va("UNK(%02X)", inst->B);
+//      inst.mode = lui::instruction_mode::ABx;
+        print_operand("OPT", inst.A); output_.write(", ");
+        if (inst.A == 20) print_constant(func, inst.Bx); else print_operand("UNK", inst.Bx);
         break;
     case opcode::HKS_OPCODE_GETGLOBAL_MEM:          // A Bx    R(A) := Gbl[Kst(Bx)]
-        inst->data += lui::reg(inst->A).print() + ", ";
-        inst->data += find_constant(func, inst->Bx).print();
+        print_register(inst.A); output_.write(", ");
+        print_constant(func, inst.Bx);
         break;
         default:
-            DISASSEMBLER_ERROR("Unhandled opcode %s", opcode_name(opcode(inst->OP)).data());
+            buffer_->fail(utils::string::va("%s at 0x%X has no listing form", opcode_name(opcode(inst.OP)).data(),
+                inst.index));
         break;
     }
 }
 
-auto disassembler::find_constant(const lui::function& func, std::int32_t index) -> lui::kst
+void disassembler::print_constant_text(const lui::kst& kst)
+{
+    switch(kst.type_)
+    {
+        case lui::data::t::BOOLEAN: output_.write(kst.boolean_ ? "true" : "false"); break;
+        case lui::data::t::NUMBER: output_.write_float(kst.number_); break;
+        case lui::data::t::STRING: output_.write_quoted(kst.string_); break;
+        default: output_.write("nil"); break;
+    }
+}
+
+// KST(value), with @index appended when an earlier constant has the same value
+void disassembler::print_constant(const lui::function& func, std::int32_t index)
 {
     if (index < 0) index = -index;
 
-    return func.constants.at(index);
+    output_.write("KST(");
+    print_constant_text(func.constants.at(index));
+
+    if (kst_dup_.at(index))
+    {
+        output_.write('@');
+        output_.write_hex(index, 2);
+    }
+
+    output_.write(')');
+}
+
+void disassembler::print_rk(const lui::function& func, std::int32_t index, bool konst)
+{
+    if (index < 0 || konst)
+        print_constant(func, index);
+    else
+        print_register(index);
+}
+
+void disassembler::print_register(std::uint32_t index)
+{
+    print_operand("REG", index);
+}
+
+void disassembler::print_operand(std::string_view name, std::uint32_t value)
+{
+    output_.write(name);
+    output_.write('(');
+    output_.write_hex(value, 2);
+    output_.write(')');
+}
+
+void disassembler::print_number(std::string_view name, std::int32_t value)
+{
+    output_.write(name);
+    output_.write('(');
+    output_.write_int(value);
+    output_.write(')');
+}
+
+void disassembler::print_range(std::uint32_t first, std::uint32_t last)
+{
+    output_.write("R(");
+    output_.write_hex(first, 2);
+    output_.write(" .. ");
+    output_.write_hex(last, 2);
+    output_.write(')');
+}
+
+void disassembler::find_duplicates(const lui::function& func)
+{
+    // interned strings compare by address, numbers by their bits
+    kst_keys_.clear();
+    kst_dup_.assign(func.constants.size(), false);
+
+    for (auto i = 0u; i < func.constants.size(); i++)
+    {
+        auto& kst = func.constants[i];
+        std::uint64_t value = 0;
+
+        switch(kst.type_)
+        {
+            case lui::data::t::BOOLEAN: value = kst.boolean_; break;
+            case lui::data::t::NUMBER: std::memcpy(&value, &kst.number_, sizeof(float)); break;
+            case lui::data::t::STRING: value = reinterpret_cast<std::uintptr_t>(kst.string_.data()); break;
+            default: break;
+        }
+
+        kst_keys_.emplace_back(kst.type_, value, i);
+    }
+
+    // equal keys end up next to each other, lowest index first
+    std::sort(kst_keys_.begin(), kst_keys_.end());
+
+    for (auto i = 1u; i < kst_keys_.size(); i++)
+    {
+        auto& prev = kst_keys_[i - 1];
+        auto& curr = kst_keys_[i];
+
+        if (std::get<0>(prev) == std::get<0>(curr) && std::get<1>(prev) == std::get<1>(curr))
+            kst_dup_[std::get<2>(curr)] = true;
+    }
 }
 
 void disassembler::print_function(const lui::function& func)
 {
-    auto info = utils::string::va("flag: %d, params: %d, upvals: %d, registers: %d, instructions: %d, constants: %d", func.vararg_flags, func.param_count, func.upval_count, func.register_count, func.instruction_count, func.constant_count);
-    output_->write_string(utils::string::va("\n%ssub_%s [%s]\n", indented(tabsize_).data(), func.name.data(), info.data()));
+    output_.write('\n');
+    output_.write_spaces(tabsize_);
+    output_.write("sub_");
+    output_.write(func.name);
+    output_.write(" [flag: ");
+    output_.write_int(func.vararg_flags);
+    output_.write(", params: ");
+    output_.write_int(func.param_count);
+    output_.write(", upvals: ");
+    output_.write_int(func.upval_count);
+    output_.write(", registers: ");
+    output_.write_int(func.register_count);
+    output_.write(", instructions: ");
+    output_.write_int(func.instruction_count);
+    output_.write(", constants: ");
+    output_.write_int(func.constant_count);
+    output_.write("]\n");
     tabsize_ += 4;
 
-    for (auto& inst : func.instructions)
+    for (auto& kst : func.constants)
+    {
+        output_.write_spaces(tabsize_);
+        output_.write_padded(".const", 14);
+        output_.write(' ');
+        print_constant_text(kst);
+        output_.write('\n');
+    }
+
+    this->find_duplicates(func);
+
+    for (auto i = 0u; i < func.code.size(); i++)
     {
-        auto it = func.labels.find(inst->index);
+        auto inst = decode_instruction(func, i);
+        auto it = func.labels.find(inst.index);
         if(it != func.labels.end())
         {
-            output_->write_string(utils::string::va("%s%-2s:\n", indented(tabsize_ - 4).data(), it->second.data()));
+            output_.write_spaces(tabsize_ - 4);
+            output_.write_padded(it->second, 2);
+            output_.write(":\n");
         }
-        output_->write_string(utils::string::va("%s%-14s %s\n", indented(tabsize_).data(), opcode_name(opcode(inst->OP)).data(), inst->data.data()));
+
+        output_.write_spaces(tabsize_);
+        output_.write_padded(opcode_name(opcode(inst.OP)), 14);
+        output_.write(' ');
+        this->print_fields(func, inst);
+        output_.write('\n');
     }
 
     // go to subfunctions
-    for (int i = 0; i < func.sub_func_count; i++)
+    for (auto i = 0u; i < func.sub_func_count; i++)
     {
         this->print_function(func.sub_funcs.at(i));
     }
 
     tabsize_ -= 4;
-    output_->write_string(utils::string::va("%send_%s\n", indented(tabsize_).data(), func.name.data()));
+    output_.write_spaces(tabsize_);
+    output_.write("end_");
+    output_.write(func.name);
+    output_.write('\n');
 }
 
 } // namespace IW6
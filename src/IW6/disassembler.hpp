@@ -11,25 +11,53 @@ namespace IW6
 
 class disassembler : public lui::disassembler
 {
-    utils::byte_buffer_ptr buffer_;
-    utils::byte_buffer_ptr output_;
+    utils::byte_view_ptr buffer_;
+    utils::text_writer output_;
     lui::file_ptr file_;
-    static int tabsize_;
+    std::uint32_t tabsize_;
+    std::vector<bool> kst_dup_;
+    std::vector<std::tuple<lui::data::t, std::uint64_t, std::uint32_t>> kst_keys_; // reused by find_duplicates
+    utils::string_pool_ptr strings_;
+
+    friend class bench;
+
+    // smallest encodings, counts read from the file are checked against them
+    // before anything is reserved for them
+    static constexpr std::size_t header_size = 18;
+    static constexpr std::size_t type_size = 9;
+    static constexpr std::size_t function_size = 21;
+    static constexpr std::uint32_t max_depth = 200;
+    static constexpr std::uint32_t max_registers = 256;
 
 public:
+    disassembler();
+    // files share the given pool instead of getting one each
+    disassembler(utils::string_pool_ptr strings);
+
     auto output() -> std::vector<std::uint8_t>;
     auto output_d() -> lui::file_ptr;
-    void disassemble(std::vector<std::uint8_t>& data);
+    auto disassemble(std::vector<std::uint8_t>& data) -> bool;
+    auto disassemble(const std::uint8_t* data, std::size_t size) -> bool;
+    auto error() -> const std::string&;
 
 private:
     void disassemble_header();
     void disassemble_functions();
     void disassemble_prototype();
-    void disassemble_function(lui::function& func);
-    void disassemble_instruction(lui::function& func);
+    void disassemble_function(lui::function& func, std::uint32_t depth);
+    void disassemble_instructions(lui::function& func);
     void disassemble_constant(lui::function& func);
-    void disassemble_fields(lui::function& func, std::uint32_t index);
-    auto find_constant(const lui::function& func, std::int32_t index) -> lui::kst;
+    void disassemble_fields(lui::function& func);
+    void check_operands(const lui::function& func, const lui::instruction& inst);
+    void print_fields(const lui::function& func, const lui::instruction& inst);
+    void print_constant_text(const lui::kst& kst);
+    void print_constant(const lui::function& func, std::int32_t index);
+    void print_rk(const lui::function& func, std::int32_t index, bool konst);
+    void print_register(std::uint32_t index);
+    void print_operand(std::string_view name, std::uint32_t value);
+    void print_number(std::string_view name, std::int32_t value);
+    void print_range(std::uint32_t first, std::uint32_t last);
+    void find_duplicates(const lui::function& func);
     void print_function(const lui::function& func);
 };
 
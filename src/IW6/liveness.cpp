@@ -0,0 +1,425 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "IW6.hpp"
+
+namespace IW6
+{
+
+void liveness::build(const lui::function& func, const cfg& graph)
+{
+    registers_ = func.register_count;
+    words_ = (registers_ + 63) / 64;
+
+    auto size = graph.size() * words_;
+
+    access_.resize(func.code.size());
+    gen_.assign(size, 0);
+    kill_.assign(size, 0);
+    out_.assign(size, 0);
+
+    for (auto id = 0u; id < graph.size(); id++)
+    {
+        this->transfer(func, graph.at(id), &gen_[id * words_], &kill_[id * words_]);
+    }
+
+    in_.assign(gen_.begin(), gen_.end());
+
+    // backward problem, so walk in postorder. loops only add a pass or two
+    const auto& rpo = graph.reverse_postorder();
+
+    for (auto changed = true; changed; )
+    {
+        changed = false;
+
+        for (auto i = rpo.size(); i-- > 0; )
+        {
+            auto id = rpo[i];
+            auto* out = &out_[id * words_];
+            auto* in = &in_[id * words_];
+            const auto* gen = &gen_[id * words_];
+            const auto* kill = &kill_[id * words_];
+
+            for (auto w = 0u; w < words_; w++)
+            {
+                std::uint64_t live = 0;
+
+                for (auto to : graph.successors(id))
+                {
+                    live |= in_[to * words_ + w];
+                }
+
+                out[w] = live;
+                live = gen[w] | (live & ~kill[w]);
+
+                if (in[w] != live)
+                {
+                    in[w] = live;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    use_.resize(func.code.size());
+    first_.resize(registers_);
+    count_.resize(registers_);
+    stamp_.assign(registers_, none);
+
+    for (auto id = 0u; id < graph.size(); id++)
+    {
+        this->find_uses(graph.at(id), id);
+    }
+}
+
+auto liveness::live_in(std::uint32_t block, std::uint32_t reg) const -> bool
+{
+    return reg < registers_ && test(&in_.at(block * words_), reg);
+}
+
+auto liveness::live_out(std::uint32_t block, std::uint32_t reg) const -> bool
+{
+    return reg < registers_ && test(&out_.at(block * words_), reg);
+}
+
+auto liveness::single_use(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> std::uint32_t
+{
+    const auto& def = access_.at(index);
+
+    if (reg == def.def_begin && def.def_begin < def.def_end) return use_[index];
+
+    // other registers of a multiple write are rare, walk to the next write
+    return this->next_use(graph, index, reg, index + 1);
+}
+
+auto liveness::next_use(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> std::uint32_t
+{
+    return this->next_use(graph, index, reg, index);
+}
+
+// reads of reg in [from, end of the block of index)
+auto liveness::next_use(const cfg& graph, std::uint32_t index, std::uint32_t reg, std::uint32_t from) const -> std::uint32_t
+{
+    auto id = graph.block_of(index);
+    auto end = graph.at(id).end;
+    auto use = none;
+
+    for (auto i = from; i < end; i++)
+    {
+        const auto& acc = access_[i];
+
+        if (reads(acc, reg))
+        {
+            if (use != none) return many;
+            use = i;
+        }
+
+        if (reg >= acc.def_begin && reg < acc.def_end) return use;
+    }
+
+    return this->live_out(id, reg) ? many : use;
+}
+
+auto liveness::reads(std::uint32_t index, std::uint32_t reg) const -> bool
+{
+    return reads(access_.at(index), reg);
+}
+
+auto liveness::reads_after(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> bool
+{
+    return this->next_use(graph, index, reg, index + 1) != none;
+}
+
+auto liveness::live_after(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> bool
+{
+    auto id = graph.block_of(index);
+    auto end = graph.at(id).end;
+
+    for (auto i = index + 1; i < end; i++)
+    {
+        if (reg >= access_[i].def_begin && reg < access_[i].def_end) return false;
+    }
+
+    return this->live_out(id, reg);
+}
+
+auto liveness::at(std::uint32_t index) const -> const access&
+{
+    return access_.at(index);
+}
+
+void liveness::registers(const lui::instruction& inst, std::uint32_t register_count, access& out)
+{
+    operands(inst, register_count, out);
+
+    out.def_end = std::min(out.def_end, register_count);
+    out.def_begin = std::min(out.def_begin, out.def_end);
+    out.use_end = std::min(out.use_end, register_count);
+    out.use_begin = std::min(out.use_begin, out.use_end);
+}
+
+void liveness::operands(const lui::instruction& inst, std::uint32_t register_count, access& out)
+{
+    auto a = std::uint32_t(inst.A);
+    auto b = std::uint32_t(inst.B);
+    auto c = std::uint32_t(inst.C);
+
+    out = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+
+    auto def = [&](std::uint32_t begin, std::uint32_t end) { out.def_begin = begin; out.def_end = end; };
+    auto run = [&](std::uint32_t begin, std::uint32_t end) { out.use_begin = begin; out.use_end = end; };
+    auto use = [&](std::uint32_t reg) { out.uses[out.use_count++] = reg; };
+    auto rk = [&]() { if (!inst.sZero) use(c); };
+
+    switch (opcode(inst.OP))
+    {
+    case opcode::HKS_OPCODE_GETFIELD:
+    case opcode::HKS_OPCODE_GETFIELD_R1:
+    case opcode::HKS_OPCODE_MOVE:
+    case opcode::HKS_OPCODE_UNM:
+    case opcode::HKS_OPCODE_NOT:
+    case opcode::HKS_OPCODE_NOT_R1:
+    case opcode::HKS_OPCODE_LEN:
+        def(a, a + 1);
+        use(b);
+        break;
+    case opcode::HKS_OPCODE_GETTABLE:
+    case opcode::HKS_OPCODE_GETTABLE_S:
+    case opcode::HKS_OPCODE_ADD:
+    case opcode::HKS_OPCODE_SUB:
+    case opcode::HKS_OPCODE_MUL:
+    case opcode::HKS_OPCODE_DIV:
+    case opcode::HKS_OPCODE_MOD:
+    case opcode::HKS_OPCODE_POW:
+        def(a, a + 1);
+        use(b);
+        rk();
+        break;
+    case opcode::HKS_OPCODE_ADD_BK:
+    case opcode::HKS_OPCODE_SUB_BK:
+    case opcode::HKS_OPCODE_MUL_BK:
+    case opcode::HKS_OPCODE_DIV_BK:
+    case opcode::HKS_OPCODE_MOD_BK:
+    case opcode::HKS_OPCODE_POW_BK:
+        def(a, a + 1);
+        use(c);
+        break;
+    case opcode::HKS_OPCODE_GETGLOBAL:
+    case opcode::HKS_OPCODE_GETGLOBAL_MEM:
+    case opcode::HKS_OPCODE_GETUPVAL:
+    case opcode::HKS_OPCODE_LOADK:
+    case opcode::HKS_OPCODE_LOADBOOL:
+    case opcode::HKS_OPCODE_NEWTABLE:
+    case opcode::HKS_OPCODE_CLOSURE:
+        def(a, a + 1);
+        break;
+    case opcode::HKS_OPCODE_LOADNIL:
+        def(a, b + 1);
+        break;
+    case opcode::HKS_OPCODE_SELF:
+        def(a, a + 2);
+        use(b);
+        rk();
+        break;
+    case opcode::HKS_OPCODE_TEST:
+    case opcode::HKS_OPCODE_TEST_R1:
+    case opcode::HKS_OPCODE_SETGLOBAL:
+    case opcode::HKS_OPCODE_SETUPVAL:
+    case opcode::HKS_OPCODE_SETUPVAL_R1:
+        use(a);
+        break;
+    // R(A) is only written when the test passes
+    case opcode::HKS_OPCODE_TESTSET:
+        use(b);
+        break;
+    case opcode::HKS_OPCODE_EQ:
+    case opcode::HKS_OPCODE_LT:
+    case opcode::HKS_OPCODE_LE:
+        use(b);
+        rk();
+        break;
+    case opcode::HKS_OPCODE_EQ_BK:
+    case opcode::HKS_OPCODE_LT_BK:
+    case opcode::HKS_OPCODE_LE_BK:
+        use(c);
+        break;
+    case opcode::HKS_OPCODE_SETFIELD:
+    case opcode::HKS_OPCODE_SETFIELD_R1:
+    case opcode::HKS_OPCODE_SETTABLE_BK:
+    case opcode::HKS_OPCODE_SETTABLE_S_BK:
+        use(a);
+        rk();
+        break;
+    case opcode::HKS_OPCODE_SETTABLE:
+    case opcode::HKS_OPCODE_SETTABLE_S:
+        use(a);
+        use(b);
+        rk();
+        break;
+    // B == 0 and C == 0 pass values up to the stack top, reads are taken to
+    // run to the last register and writes to be unknown
+    case opcode::HKS_OPCODE_CALL:
+    case opcode::HKS_OPCODE_CALL_I:
+    case opcode::HKS_OPCODE_CALL_I_R1:
+        run(a, (b == 0) ? register_count : a + b);
+        if (c > 1) def(a, a + c - 1);
+        break;
+    case opcode::HKS_OPCODE_TAILCALL:
+    case opcode::HKS_OPCODE_TAILCALL_I:
+    case opcode::HKS_OPCODE_TAILCALL_I_R1:
+        run(a, (b == 0) ? register_count : a + b);
+        break;
+    case opcode::HKS_OPCODE_RETURN:
+        run(a, (b == 0) ? register_count : a + b - 1);
+        break;
+    case opcode::HKS_OPCODE_SETLIST:
+        run(a, (b == 0) ? register_count : a + b + 1);
+        break;
+    case opcode::HKS_OPCODE_VARARG:
+        if (b > 1) def(a, a + b - 1);
+        break;
+    case opcode::HKS_OPCODE_CONCAT:
+        def(a, a + 1);
+        run(b, c + 1);
+        break;
+    case opcode::HKS_OPCODE_FORPREP:
+    case opcode::HKS_OPCODE_FORLOOP:
+        def(a, a + 1);
+        run(a, a + 3);
+        break;
+    case opcode::HKS_OPCODE_TFORLOOP:
+        def(a + 3, a + 3 + c);
+        run(a, a + 3);
+        break;
+    // upvalue captured by the CLOSURE before it
+    case opcode::HKS_OPCODE_DATA:
+        if (a == 1) use(std::uint32_t(inst.Bx));
+        break;
+    default:
+        break;
+    }
+}
+
+void liveness::transfer(const lui::function& func, const cfg::block& b, std::uint64_t* gen, std::uint64_t* kill)
+{
+    auto open = none;
+
+    // gen is read before any write in the block, kill is written
+    for (auto i = b.begin; i < b.end; i++)
+    {
+        auto& acc = access_[i];
+        auto inst = decode_instruction(func, i);
+        registers(inst, registers_, acc);
+
+        // a read up to the stack top ends where the open call or vararg
+        // before it put its first value
+        if (acc.use_end == registers_ && open != none) acc.use_end = std::max(open, acc.use_begin);
+
+        open = none;
+
+        switch (opcode(inst.OP))
+        {
+        case opcode::HKS_OPCODE_CALL:
+        case opcode::HKS_OPCODE_CALL_I:
+        case opcode::HKS_OPCODE_CALL_I_R1:
+            if (inst.C == 0) open = inst.A + 1;
+            break;
+        case opcode::HKS_OPCODE_VARARG:
+            if (inst.B == 0) open = inst.A + 1;
+            break;
+        default:
+            break;
+        }
+
+        for (auto u = 0u; u < acc.use_count; u++)
+        {
+            auto reg = acc.uses[u];
+            if (reg < registers_ && !test(kill, reg)) gen[reg / 64] |= std::uint64_t(1) << (reg % 64);
+        }
+
+        for (auto w = acc.use_begin / 64; acc.use_begin < acc.use_end && w <= (acc.use_end - 1) / 64; w++)
+        {
+            gen[w] |= mask(w, acc.use_begin, acc.use_end) & ~kill[w];
+        }
+
+        for (auto w = acc.def_begin / 64; acc.def_begin < acc.def_end && w <= (acc.def_end - 1) / 64; w++)
+        {
+            kill[w] |= mask(w, acc.def_begin, acc.def_end);
+        }
+    }
+}
+
+// one backward walk over the block keeps, per register, the nearest read
+// and how many reads there are (two meaning many) before the next write, so
+// each write looks its reads up where it happens. registers are stamped with
+// the block that last touched them instead of being reset for every block
+void liveness::find_uses(const cfg::block& b, std::uint32_t id)
+{
+    const auto* out = &out_[id * words_];
+
+    auto touch = [&](std::uint32_t reg)
+    {
+        if (stamp_[reg] == id) return;
+        stamp_[reg] = id;
+        first_[reg] = none;
+        count_[reg] = test(out, reg) ? 2 : 0;
+    };
+
+    for (auto i = b.end; i-- > b.begin; )
+    {
+        const auto& acc = access_[i];
+
+        use_[i] = none;
+
+        for (auto reg = acc.def_begin; reg < acc.def_end; reg++)
+        {
+            touch(reg);
+            if (reg == acc.def_begin) use_[i] = (count_[reg] > 1) ? many : first_[reg];
+            first_[reg] = none;
+            count_[reg] = 0;
+        }
+
+        auto read = [&](std::uint32_t reg)
+        {
+            if (reg >= registers_) return;
+            touch(reg);
+            if (first_[reg] == i) return;
+            first_[reg] = i;
+            count_[reg] = std::min(count_[reg] + 1, 2u);
+        };
+
+        for (auto u = 0u; u < acc.use_count; u++) read(acc.uses[u]);
+        for (auto reg = acc.use_begin; reg < acc.use_end; reg++) read(reg);
+    }
+}
+
+auto liveness::reads(const access& acc, std::uint32_t reg) -> bool
+{
+    if (reg >= acc.use_begin && reg < acc.use_end) return true;
+
+    for (auto u = 0u; u < acc.use_count; u++)
+    {
+        if (acc.uses[u] == reg) return true;
+    }
+
+    return false;
+}
+
+auto liveness::test(const std::uint64_t* set, std::uint32_t reg) -> bool
+{
+    return (set[reg / 64] >> (reg % 64)) & 1;
+}
+
+// bits of word w that fall in the register run [begin, end)
+auto liveness::mask(std::uint32_t w, std::uint32_t begin, std::uint32_t end) -> std::uint64_t
+{
+    auto first = std::max(begin, w * 64) - w * 64;
+    auto last = std::min(end, w * 64 + 64) - w * 64;
+    auto high = (last == 64) ? ~std::uint64_t(0) : (std::uint64_t(1) << last) - 1;
+
+    return high & ~((std::uint64_t(1) << first) - 1);
+}
+
+} // namespace IW6
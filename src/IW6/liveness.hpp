@@ -0,0 +1,90 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_IW6_LIVENESS_HPP_
+#define _LUI_IW6_LIVENESS_HPP_
+
+namespace IW6
+{
+
+// register liveness of one function over its cfg. every register set is a
+// run of 64 bit words, all sets of a kind live in one flat array indexed by
+// block id, so the transfer functions work a word at a time.
+class liveness
+{
+public:
+    static constexpr std::uint32_t none = 0xFFFFFFFF;
+    static constexpr std::uint32_t many = 0xFFFFFFFE;
+
+    // registers an instruction reads and writes. reads are a run plus up to
+    // three single registers, writes are a run. only unconditional writes
+    // are listed, so a value is never thought dead too early
+    struct access
+    {
+        std::uint32_t def_begin;
+        std::uint32_t def_end;
+        std::uint32_t use_begin;
+        std::uint32_t use_end;
+        std::uint32_t uses[3];
+        std::uint32_t use_count;
+    };
+
+private:
+    std::uint32_t registers_;
+    std::uint32_t words_;
+    std::vector<access> access_;
+    std::vector<std::uint64_t> gen_;
+    std::vector<std::uint64_t> kill_;
+    std::vector<std::uint64_t> in_;
+    std::vector<std::uint64_t> out_;
+    std::vector<std::uint32_t> use_;
+    std::vector<std::uint32_t> first_;
+    std::vector<std::uint32_t> count_;
+    std::vector<std::uint32_t> stamp_;
+
+public:
+    void build(const lui::function& func, const cfg& graph);
+
+    auto live_in(std::uint32_t block, std::uint32_t reg) const -> bool;
+    auto live_out(std::uint32_t block, std::uint32_t reg) const -> bool;
+
+    // the one instruction reading the value written to reg at index. none
+    // when nothing reads it, many when it is read more than once or past
+    // the end of its block
+    auto single_use(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> std::uint32_t;
+
+    // the one instruction reading reg from index on, before it is written
+    // again. none and many as for single_use
+    auto next_use(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> std::uint32_t;
+
+    // whether the value written to reg at index is still there, and live,
+    // when its block ends
+    auto live_after(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> bool;
+
+    // whether reg is read at index, or after it before the block ends or
+    // while still live out of it
+    auto reads(std::uint32_t index, std::uint32_t reg) const -> bool;
+    auto reads_after(const cfg& graph, std::uint32_t index, std::uint32_t reg) const -> bool;
+
+    auto at(std::uint32_t index) const -> const access&;
+
+    static void registers(const lui::instruction& inst, std::uint32_t register_count, access& out);
+
+    // the same as encoded, not clamped to the register count, so a file can
+    // be checked against it
+    static void operands(const lui::instruction& inst, std::uint32_t register_count, access& out);
+
+private:
+    void transfer(const lui::function& func, const cfg::block& b, std::uint64_t* gen, std::uint64_t* kill);
+    void find_uses(const cfg::block& b, std::uint32_t id);
+    auto next_use(const cfg& graph, std::uint32_t index, std::uint32_t reg, std::uint32_t from) const -> std::uint32_t;
+    static auto reads(const access& acc, std::uint32_t reg) -> bool;
+    static auto test(const std::uint64_t* set, std::uint32_t reg) -> bool;
+    static auto mask(std::uint32_t w, std::uint32_t begin, std::uint32_t end) -> std::uint64_t;
+};
+
+} // namespace IW6
+
+#endif // _LUI_IW6_LIVENESS_HPP_
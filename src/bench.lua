@@ -0,0 +1,25 @@
+bench = {}
+
+function bench:include()
+    includedirs { path.join(project_folder(), "bench") }
+end
+
+function bench:project()
+    local folder = project_folder();
+
+    project "lui-bench"
+        kind "ConsoleApp"
+        language "C++"
+
+        files
+        {
+            path.join(folder, "bench/**.h"),
+            path.join(folder, "bench/**.hpp"),
+            path.join(folder, "bench/**.cpp")
+        }
+
+        -- Linked projects
+        self:include()
+        utils:link()
+        IW6:link()
+end
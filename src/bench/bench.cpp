@@ -0,0 +1,316 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "stdinc.hpp"
+
+// every heap allocation in the process goes through here so stages can
+// report how many they made, and the leak check can see what is still live
+static std::atomic<std::size_t> alloc_count { 0 };
+static std::atomic<std::size_t> live_bytes { 0 };
+static std::atomic<std::size_t> peak_bytes { 0 };
+
+// the block size is kept in front of the block for operator delete
+static constexpr std::size_t alloc_header = alignof(std::max_align_t);
+
+void* operator new(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (auto ptr = static_cast<std::uint8_t*>(std::malloc(size + alloc_header)))
+    {
+        *reinterpret_cast<std::size_t*>(ptr) = size;
+
+        auto live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        auto peak = peak_bytes.load(std::memory_order_relaxed);
+
+        while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+        return ptr + alloc_header;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr == nullptr) return;
+
+    auto block = static_cast<std::uint8_t*>(ptr) - alloc_header;
+    live_bytes.fetch_sub(*reinterpret_cast<std::size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace IW6
+{
+
+bench::bench(double min_time) : min_time_(min_time) {}
+
+void bench::load(const std::string& path)
+{
+    std::vector<std::string> files;
+
+    if (std::filesystem::is_directory(path))
+    {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".luac")
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+    }
+    else
+    {
+        files.push_back(path);
+    }
+
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files)
+    {
+        samples_.push_back({ file, utils::file::read(file), 0 });
+
+        auto& s = samples_.back();
+
+        if (!disassembler_.disassemble(s.data))
+        {
+            printf("skipping %s: %s\n", file.data(), disassembler_.error().data());
+            samples_.pop_back();
+            continue;
+        }
+
+        s.instructions = count_instructions(disassembler_.output_d()->main);
+    }
+}
+
+void bench::run(const std::string& filter)
+{
+    auto stage = [&](const std::string& name, const setup& prepare, const body& func)
+    {
+        if (filter.empty() || name.find(filter) != std::string::npos)
+        {
+            this->run_stage(name, prepare, func);
+        }
+    };
+
+    stage("disassemble_header/functions", [](const sample&) {}, [&](const sample& s) { this->parse(s); });
+
+    stage("find_invalid_opcode", [&](const sample& s) { this->parse(s); }, [&](const sample&)
+    {
+        this->validate(disassembler_.file_->main);
+    });
+
+    stage("disassemble_fields", [&](const sample& s) { this->parse(s); }, [&](const sample&)
+    {
+        disassembler_.disassemble_fields(disassembler_.file_->main);
+    });
+
+    stage("cfg::build", [&](const sample& s) { this->disassemble(s); }, [&](const sample&)
+    {
+        this->build_cfg(disassembler_.file_->main);
+    });
+
+    // cfg::build plus the dataflow on top of it
+    stage("liveness::build", [&](const sample& s) { this->disassemble(s); }, [&](const sample&)
+    {
+        this->build_liveness(disassembler_.file_->main);
+    });
+
+    stage("print_function", [&](const sample& s) { this->disassemble(s); }, [&](const sample&)
+    {
+        disassembler_.output();
+    });
+
+    stage("image::write", [&](const sample& s) { this->disassemble(s); }, [&](const sample&)
+    {
+        image_ = lui::image::write(*disassembler_.file_);
+    });
+
+    stage("image::load", [&](const sample& s)
+    {
+        this->disassemble(s);
+        image_ = lui::image::write(*disassembler_.file_);
+    },
+    [&](const sample&)
+    {
+        file_ = lui::image(image_).load();
+    });
+
+    stage("decompiler::decompile", [&](const sample& s) { this->take_file(s); }, [&](const sample&)
+    {
+        decompiler_.decompile(std::move(file_));
+    });
+
+    stage("printer::print", [&](const sample& s) { this->decompile(s); }, [&](const sample&)
+    {
+        utils::text_writer output;
+        lui::printer(output).print(*decompiler_.script_);
+    });
+
+    stage("assembler::assemble", [&](const sample& s) { this->take_file(s); }, [&](const sample&)
+    {
+        assembler_.assemble(std::move(file_));
+        assembler_.output();
+    });
+}
+
+void bench::report()
+{
+    printf("%-30s %12s %10s %12s %12s %12s\n", "stage", "time/pass", "passes", "ns/inst", "MB/s", "allocs/file");
+    printf("%s\n", std::string(93, '-').data());
+
+    for (const auto& res : results_)
+    {
+        auto per_pass = res.time / res.iterations;
+        auto files = samples_.size() * res.iterations;
+
+        printf("%-30s %9.3f ms %10zu %12.2f %12.2f %12.1f\n", res.name.data(), per_pass * 1e3, res.iterations,
+            (res.time * 1e9) / double(res.instructions), (double(res.bytes) / res.time) / (1024.0 * 1024.0),
+            double(res.allocs) / double(files));
+    }
+}
+
+auto bench::leak_check(std::size_t passes) -> int
+{
+    // the first pass grows every pool and arena to its working size, after
+    // that the live heap at the end of a pass must not move
+    std::size_t baseline = 0;
+    auto failed = false;
+
+    printf("%-6s %14s %14s %14s\n", "pass", "live bytes", "peak bytes", "growth");
+    printf("%s\n", std::string(51, '-').data());
+
+    for (auto i = 0u; i < passes; i++)
+    {
+        for (const auto& s : samples_)
+        {
+            this->decompile(s);
+            decompiler_.output();
+        }
+
+        auto live = live_bytes.load(std::memory_order_relaxed);
+        auto growth = (i == 0) ? 0 : std::int64_t(live) - std::int64_t(baseline);
+
+        if (i == 0) baseline = live;
+        if (growth > 0) failed = true;
+
+        printf("%-6u %14zu %14zu %+14jd\n", i + 1, live, peak_bytes.load(std::memory_order_relaxed),
+            std::intmax_t(growth));
+    }
+
+    printf("%s: %zu files x %zu passes\n", failed ? "LEAK" : "ok", samples_.size(), passes);
+
+    return failed ? 1 : 0;
+}
+
+void bench::run_stage(const std::string& name, const setup& prepare, const body& func)
+{
+    result res { name, 0, 0.0, 0, 0, 0 };
+
+    // whole passes over every sample until the minimum time is reached
+    do
+    {
+        for (const auto& s : samples_)
+        {
+            prepare(s);
+
+            auto allocs = alloc_count.load(std::memory_order_relaxed);
+            auto begin = std::chrono::steady_clock::now();
+
+            func(s);
+
+            res.time += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            res.allocs += alloc_count.load(std::memory_order_relaxed) - allocs;
+            res.bytes += s.data.size();
+            res.instructions += s.instructions;
+        }
+
+        res.iterations++;
+    }
+    while (res.time < min_time_);
+
+    results_.push_back(res);
+}
+
+void bench::parse(const sample& s)
+{
+    disassembler_.output_.clear();
+    disassembler_.buffer_ = std::make_unique<utils::byte_view>(s.data.data(), s.data.size());
+    disassembler_.file_ = std::make_unique<lui::file>();
+    disassembler_.file_->strings = std::make_shared<utils::string_pool>();
+    disassembler_.disassemble_header();
+    disassembler_.disassemble_functions();
+    disassembler_.disassemble_prototype();
+}
+
+void bench::disassemble(const sample& s)
+{
+    disassembler_.disassemble(s.data.data(), s.data.size());
+}
+
+void bench::take_file(const sample& s)
+{
+    this->disassemble(s);
+    file_ = disassembler_.output_d();
+}
+
+void bench::decompile(const sample& s)
+{
+    this->take_file(s);
+    decompiler_.decompile(std::move(file_));
+}
+
+void bench::validate(const lui::function& func)
+{
+    if (find_invalid_opcode(func.code.data(), func.code.size()) != func.code.size())
+    {
+        LOG_ERROR("invalid opcode in %s", func.name.data());
+    }
+
+    for (const auto& sub : func.sub_funcs)
+    {
+        this->validate(sub);
+    }
+}
+
+void bench::build_cfg(const lui::function& func)
+{
+    cfg_.build(func);
+
+    for (const auto& sub : func.sub_funcs)
+    {
+        this->build_cfg(sub);
+    }
+}
+
+void bench::build_liveness(const lui::function& func)
+{
+    cfg_.build(func);
+    live_.build(func, cfg_);
+
+    for (const auto& sub : func.sub_funcs)
+    {
+        this->build_liveness(sub);
+    }
+}
+
+auto bench::count_instructions(const lui::function& func) -> std::size_t
+{
+    auto count = func.code.size();
+
+    for (const auto& sub : func.sub_funcs)
+    {
+        count += count_instructions(sub);
+    }
+
+    return count;
+}
+
+} // namespace IW6
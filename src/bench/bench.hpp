@@ -0,0 +1,73 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_BENCH_HPP_
+#define _LUI_BENCH_HPP_
+
+namespace IW6
+{
+
+// times each stage of the IW6 pipeline on its own, the stage under test runs
+// on state prepared by the untimed setup of the stages before it
+class bench
+{
+public:
+    struct sample
+    {
+        std::string file;
+        std::vector<std::uint8_t> data;
+        std::size_t instructions;
+    };
+
+    struct result
+    {
+        std::string name;
+        std::size_t iterations;
+        double time;
+        std::size_t bytes;
+        std::size_t instructions;
+        std::size_t allocs;
+    };
+
+    using setup = std::function<void(const sample&)>;
+    using body = std::function<void(const sample&)>;
+
+private:
+    std::vector<sample> samples_;
+    std::vector<result> results_;
+    double min_time_;
+
+    disassembler disassembler_;
+    decompiler decompiler_;
+    assembler assembler_;
+    cfg cfg_;
+    liveness live_;
+    lui::file_ptr file_;
+    std::vector<std::uint8_t> image_;
+
+public:
+    bench(double min_time);
+
+    void load(const std::string& path);
+    void run(const std::string& filter);
+    void report();
+    auto leak_check(std::size_t passes) -> int;
+    auto check() -> int;
+
+private:
+    void run_stage(const std::string& name, const setup& prepare, const body& func);
+    void parse(const sample& s);
+    void disassemble(const sample& s);
+    void take_file(const sample& s);
+    void decompile(const sample& s);
+    void validate(const lui::function& func);
+    void build_cfg(const lui::function& func);
+    void build_liveness(const lui::function& func);
+    static auto count_instructions(const lui::function& func) -> std::size_t;
+};
+
+} // namespace IW6
+
+#endif // _LUI_BENCH_HPP_
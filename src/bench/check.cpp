@@ -0,0 +1,164 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "stdinc.hpp"
+
+namespace IW6
+{
+
+// listings assembled, disassembled and decompiled again, each one a shape
+// the decompiler once got wrong
+struct check_case
+{
+    const char* name;
+    const char* listing;
+    const char* expected;
+};
+
+static const check_case check_cases[] =
+{
+    {
+        // the copy must still hold the old value when the local is compared
+        // with its new one
+        "copy of a reassigned local",
+        R"(sub__init_ [flag: 2, params: 0, upvals: 0, registers: 2, instructions: 2, constants: 0]
+    CLOSURE        REG(00), FUN(00)
+    RETURN         REG(00), OPT(01)
+
+    sub__func_1 [flag: 0, params: 1, upvals: 0, registers: 4, instructions: 8, constants: 0]
+        MOVE           REG(01), REG(00)
+    LOC_1:
+        MOVE           REG(02), REG(01)
+        MOVE           REG(03), REG(00)
+        CALL_I         REG(03), ARG(01), RET(02)
+        MOVE           REG(01), REG(03)
+        EQ             REG(00), REG(02), REG(01)
+        JMP            LOC_1
+        RETURN         REG(00), OPT(01)
+    end__func_1
+end__init_
+)",
+        R"(
+
+local function _func_118(arg0)
+    var0 = arg0
+    repeat
+        var1 = var0
+        var2 = arg0()
+        var0 = var2
+    until var1 == var0
+end
+)"
+    },
+    {
+        "swap of two locals",
+        R"(sub__init_ [flag: 2, params: 0, upvals: 0, registers: 2, instructions: 2, constants: 0]
+    CLOSURE        REG(00), FUN(00)
+    RETURN         REG(00), OPT(01)
+
+    sub__func_1 [flag: 0, params: 1, upvals: 0, registers: 4, instructions: 9, constants: 2]
+        .const         "a"
+        .const         "b"
+        LOADK          REG(01), KST("a")
+        LOADK          REG(02), KST("b")
+        TEST           REG(00), BOOL(0)
+        JMP            LOC_1
+        MOVE           REG(03), REG(01)
+        MOVE           REG(01), REG(02)
+        MOVE           REG(02), REG(03)
+    LOC_1:
+        RETURN         REG(01), OPT(03)
+        RETURN         REG(00), OPT(01)
+    end__func_1
+end__init_
+)",
+        R"(
+
+local function _func_118(arg0)
+    var0 = "a"
+    var1 = "b"
+    if arg0 then
+        var2 = var0
+        var0 = var1
+        var1 = var2
+    end
+    return var0, var1
+end
+)"
+    },
+    {
+        "length of a concatenation",
+        R"(sub__init_ [flag: 2, params: 0, upvals: 0, registers: 2, instructions: 2, constants: 0]
+    CLOSURE        REG(00), FUN(00)
+    RETURN         REG(00), OPT(01)
+
+    sub__func_1 [flag: 0, params: 2, upvals: 0, registers: 4, instructions: 6, constants: 0]
+        MOVE           REG(02), REG(00)
+        MOVE           REG(03), REG(01)
+        CONCAT         REG(02), R(02 .. 03)
+        LEN            REG(02), REG(02)
+        RETURN         REG(02), OPT(02)
+        RETURN         REG(00), OPT(01)
+    end__func_1
+end__init_
+)",
+        R"(
+
+local function _func_118(arg0, arg1)
+    return #(arg0 .. arg1)
+end
+)"
+    },
+};
+
+auto bench::check() -> int
+{
+    static constexpr std::string_view banner = "-- IW6 PC LUI\n-- Decompiled by https://github.com/xensik/lui-tool\n";
+
+    auto failed = 0u;
+
+    for (const auto& c : check_cases)
+    {
+        std::string_view listing = c.listing;
+        std::vector<std::uint8_t> text(listing.begin(), listing.end());
+
+        assembler_.assemble(text);
+        auto data = assembler_.output();
+
+        std::string output;
+
+        if (!disassembler_.disassemble(data))
+        {
+            output = "disassemble: " + disassembler_.error();
+        }
+        else if (!decompiler_.decompile(disassembler_.output_d()))
+        {
+            output = "decompile: " + decompiler_.error();
+        }
+        else
+        {
+            auto bytes = decompiler_.output();
+            output.assign(bytes.begin(), bytes.end());
+        }
+
+        if (output.size() >= banner.size() && output.compare(0, banner.size(), banner) == 0)
+            output.erase(0, banner.size());
+
+        if (output == c.expected)
+        {
+            printf("ok     %s\n", c.name);
+            continue;
+        }
+
+        printf("FAILED %s\n--- expected\n%s--- got\n%s---\n", c.name, c.expected, output.data());
+        failed++;
+    }
+
+    printf("%s: %zu cases, %u failed\n", failed ? "FAILED" : "ok", std::size(check_cases), failed);
+
+    return failed ? 1 : 0;
+}
+
+} // namespace IW6
@@ -0,0 +1,72 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "stdinc.hpp"
+
+int main(int argc, char** argv)
+{
+    std::string path = "data/IW6/ui/lui";
+    std::string filter;
+    double min_time = 0.5;
+    std::size_t leak_passes = 0;
+    auto check = false;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "-filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (arg == "-time" && i + 1 < argc)
+        {
+            min_time = std::atof(argv[++i]);
+        }
+        else if (arg == "-leak" && i + 1 < argc)
+        {
+            leak_passes = std::atoi(argv[++i]);
+        }
+        else if (arg == "-check")
+        {
+            check = true;
+        }
+        else if (arg[0] == '-')
+        {
+            printf("usage: lui-bench [-filter <stage>] [-time <seconds>] [-leak <passes>] [-check] [path]\n");
+            return 0;
+        }
+        else
+        {
+            path = arg;
+        }
+    }
+
+    // decompiles its own listings, the corpus is not needed
+    if (check)
+    {
+        return IW6::bench(min_time).check();
+    }
+
+    if (!std::filesystem::exists(path))
+    {
+        printf("Path \"%s\" not found.\n", path.data());
+        return 1;
+    }
+
+    IW6::bench bench(min_time);
+
+    bench.load(path);
+
+    if (leak_passes > 0)
+    {
+        return bench.leak_check(leak_passes);
+    }
+
+    bench.run(filter);
+    bench.report();
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_BENCH_STDINC_HPP_
+#define _LUI_BENCH_STDINC_HPP_
+
+#include <utils.hpp>
+#include <IW6.hpp>
+
+#include "bench.hpp"
+
+#endif // _LUI_BENCH_STDINC_HPP_
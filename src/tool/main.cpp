@@ -53,10 +53,67 @@ void assemble_file(lui::assembler& assembler, std::string file)
 
 using namespace std::filesystem;
 
-void disassemble_dir(lui::disassembler& disassembler, const std::filesystem::path& dir_path)
+using disassembler_factory = std::function<std::unique_ptr<lui::disassembler>()>;
+using assembler_factory = std::function<std::unique_ptr<lui::assembler>()>;
+using decompiler_factory = std::function<std::unique_ptr<lui::decompiler>()>;
+
+// command line switches between the mode and the file
+struct options
+{
+    std::string cache_dir;
+    std::uintmax_t cache_size = 256;    // MiB
+};
+
+struct batch_entry
+{
+    std::string file;
+    std::uintmax_t size;
+    double time;
+    std::string error;
+};
+
+// lists the files that failed, returns how many
+auto print_failures(const std::vector<batch_entry>& entries) -> std::size_t
+{
+    auto failed = std::size_t(0);
+
+    for (const auto& entry : entries)
+    {
+        if (entry.error.empty()) continue;
+
+        printf("FAILED %s: %s\n", entry.file.data(), entry.error.data());
+        failed++;
+    }
+
+    return failed;
+}
+
+void print_batch_report(const char* action, std::vector<batch_entry>& entries, std::size_t threads, double time)
 {
+    printf("%s %zu files in %.3fs (%.1f files/s, %zu threads)\n", action, entries.size(), time,
+        (time > 0.0) ? entries.size() / time : 0.0, threads);
+
+    std::sort(entries.begin(), entries.end(), [](const batch_entry& a, const batch_entry& b)
+    {
+        return a.time > b.time;
+    });
+
+    auto count = std::min<std::size_t>(entries.size(), 10);
+
+    if (count > 0) printf("slowest files:\n");
+
+    for (auto i = 0u; i < count; i++)
+    {
+        printf("%10.3f ms %10ju bytes  %s\n", entries[i].time * 1000.0, entries[i].size, entries[i].file.data());
+    }
+}
+
+auto collect_batch(const std::filesystem::path& dir_path) -> std::vector<batch_entry>
+{
+    std::vector<batch_entry> entries;
+
     if (!std::filesystem::exists(dir_path)) 
-        return;
+        return entries;
 
     for (const directory_entry& entry : recursive_directory_iterator(dir_path))
     {
@@ -64,81 +121,532 @@ void disassemble_dir(lui::disassembler& disassembler, const std::filesystem::pat
 
         if (is_directory(entry.status()) && std::string(path).find(".DS_Store") != std::string::npos)
         {
-            //recurse_dir(disassembler, entry.path());
             continue;
         }
         else if(entry.is_regular_file() && std::string(path).find(".luac") != std::string::npos)
         {
+            entries.push_back({ std::string(path), entry.file_size(), 0.0, {} });
+        }
+    }
 
-            auto file = std::string(path);
-            const auto ext = std::string(".luac");
-            const auto extpos = file.find(ext);
-            
-            if (extpos != std::string::npos)
-            {
-                file.replace(extpos, ext.length(), "");
-            }
+    // largest files first so the long tail is spread across workers
+    std::sort(entries.begin(), entries.end(), [](const batch_entry& a, const batch_entry& b)
+    {
+        return a.size > b.size;
+    });
+
+    return entries;
+}
 
-            auto data = utils::file::read(file + ".luac");
+// file without its extension, so the outputs are named after it
+auto strip_extension(std::string file, const std::string& ext) -> std::string
+{
+    const auto extpos = file.find(ext);
 
-            disassembler.disassemble(data);
-            LOG_INFO("%s disasembled.", file.data());
-           // utils::file::save(file + ".luasm", disassembler.output());
+    if (extpos != std::string::npos)
+    {
+        file.replace(extpos, ext.length(), "");
+    }
+
+    return file;
+}
+
+// the executable is hashed into the cache key, so a rebuild that may change
+// any output starts from a fresh cache. the build stamp of main.cpp alone
+// would miss rebuilds of the other sources. it is hashed where it is mapped,
+// and the build time stands in when it can't be
+auto cache_version() -> std::string
+{
+    auto exe = utils::mapped_file(utils::file::executable());
+
+    if (exe.size() == 0) return utils::string::va("%s %s %s", tool_version.data(), __DATE__, __TIME__);
+
+    return std::string(tool_version) + ' ' + utils::hash::to_hex(utils::hash::xxh64(exe.data(), exe.size()));
+}
+
+// the output of a file, from the cache when it was produced for the same
+// bytes by this build before. nothing is stored when produce fails
+template <typename Produce>
+auto cached_output(utils::cache* cache, std::uint64_t key, std::string_view kind, const std::string& error,
+    const Produce& produce) -> std::vector<std::uint8_t>
+{
+    if (cache == nullptr) return produce();
+
+    std::vector<std::uint8_t> output;
+
+    if (cache->load(key, kind, output)) return output;
+
+    output = produce();
+
+    if (error.empty()) cache->store(key, kind, output);
+
+    return output;
+}
+
+// the disassembled file from a cached image when there is one. a fresh one
+// is imaged for the next stage that needs it. null when the data is invalid
+auto load_file(lui::disassembler& disassembler, utils::cache* cache, std::uint64_t key,
+    const std::uint8_t* data, std::size_t size, std::string& error) -> lui::file_ptr
+{
+    std::vector<std::uint8_t> image;
+
+    // looked up on a miss of the output, which already counted the request.
+    // a damaged image is a miss too, the file is disassembled and stored again
+    if (cache != nullptr && cache->load(key, ".luair", image, false))
+    {
+        if (auto file = lui::image(image).load()) return file;
+    }
+
+    if (!disassembler.disassemble(data, size))
+    {
+        error = disassembler.error();
+        return nullptr;
+    }
+
+    auto file = disassembler.output_d();
+
+    if (cache != nullptr) cache->store(key, ".luair", lui::image::write(*file));
+
+    return file;
+}
+
+// outputs are empty and error tells why when the data is invalid
+auto disassemble_data(lui::disassembler& disassembler, utils::cache* cache, const std::uint8_t* data,
+    std::size_t size, std::string& error) -> std::vector<std::uint8_t>
+{
+    auto key = (cache != nullptr) ? cache->key(data, size) : 0;
+
+    return cached_output(cache, key, ".luasm", error, [&]
+    {
+        if (!disassembler.disassemble(data, size))
+        {
+            error = disassembler.error();
+            return std::vector<std::uint8_t>();
         }
+
+        auto listing = disassembler.output();
+
+        if (!disassembler.error().empty())
+        {
+            error = disassembler.error();
+            return std::vector<std::uint8_t>();
+        }
+
+        // imaged for -decomp unless an earlier run already did. a damaged one
+        // is replaced when load_file finds it
+        std::vector<std::uint8_t> image;
+
+        if (cache != nullptr && !cache->load(key, ".luair", image, false))
+        {
+            cache->store(key, ".luair", lui::image::write(*disassembler.output_d()));
+        }
+
+        return listing;
+    });
+}
+
+auto decompile_data(lui::disassembler& disassembler, lui::decompiler& decompiler, utils::cache* cache,
+    const std::uint8_t* data, std::size_t size, std::string& error) -> std::vector<std::uint8_t>
+{
+    auto key = (cache != nullptr) ? cache->key(data, size) : 0;
+
+    return cached_output(cache, key, ".lua", error, [&]
+    {
+        auto file = load_file(disassembler, cache, key, data, size, error);
+
+        if (file == nullptr) return std::vector<std::uint8_t>();
+
+        if (!decompiler.decompile(std::move(file)))
+        {
+            error = decompiler.error();
+            return std::vector<std::uint8_t>();
+        }
+
+        return decompiler.output();
+    });
+}
+
+// a file on its way through the pipeline, the .luac going in and the output
+// coming out
+struct batch_job
+{
+    std::size_t index;
+    std::vector<std::uint8_t> data;
+};
+
+using batch_task = std::function<auto(std::size_t worker, const std::vector<std::uint8_t>& data, std::string& error)
+    -> std::vector<std::uint8_t>>;
+
+// runs every entry through three stages: one thread reads the files ahead,
+// the pool turns them into outputs and one thread writes those out. bounded
+// queues in between keep reading and writing at most a few files ahead of or
+// behind the pool, so disk latency overlaps the work without piling up files
+// in memory. files that fail are reported and get no output
+auto run_pipeline(const char* action, const std::string& ext, std::vector<batch_entry>& entries,
+    utils::thread_pool& pool, utils::cache* cache, const batch_task& task) -> int
+{
+    utils::bounded_queue<batch_job> loaded(pool.size() * 2);
+    utils::bounded_queue<batch_job> processed(pool.size() * 2);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread reader([&]
+    {
+        for (auto i = 0u; i < entries.size(); i++)
+        {
+            batch_job job { i, {} };
+
+            if (!utils::file::read(entries[i].file, job.data)) entries[i].error = "couldn't read file";
+
+            loaded.push(std::move(job));
+        }
+
+        loaded.close();
+    });
+
+    std::thread writer([&]
+    {
+        batch_job job;
+
+        while (processed.pop(job))
+        {
+            auto& entry = entries[job.index];
+
+            if (!entry.error.empty()) continue;
+
+            auto output = strip_extension(entry.file, ".luac") + ext;
+
+            if (!utils::file::save(output, job.data)) entry.error = "couldn't write " + output;
+        }
+    });
+
+    // each task takes whichever file was read next
+    pool.run(entries.size(), [&](std::size_t worker, std::size_t)
+    {
+        batch_job job;
+
+        if (!loaded.pop(job)) return;
+
+        auto& entry = entries[job.index];
+        auto begin = std::chrono::steady_clock::now();
+
+        // a file that couldn't be read goes on to the writer, which skips it
+        if (entry.error.empty()) job.data = task(worker, job.data, entry.error);
+
+        entry.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        processed.push(std::move(job));
+    });
+
+    processed.close();
+    reader.join();
+    writer.join();
+
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto failed = print_failures(entries);
+
+    print_batch_report(action, entries, pool.size(), time);
+
+    if (failed != 0) printf("%zu files failed\n", failed);
+
+    if (cache != nullptr) cache->print_stats();
+
+    return (failed == 0) ? 0 : 1;
+}
+
+auto disassemble_dir(const disassembler_factory& factory, utils::cache* cache, const std::filesystem::path& dir_path) -> int
+{
+    auto entries = collect_batch(dir_path);
+
+    if (entries.empty())
+        return 0;
+
+    utils::thread_pool pool;
+    std::vector<std::unique_ptr<lui::disassembler>> disassemblers;
+
+    for (auto i = 0u; i < pool.size(); i++)
+    {
+        disassemblers.push_back(factory());
     }
+
+    return run_pipeline("disassembled", ".luasm", entries, pool, cache, [&](std::size_t worker,
+        const std::vector<std::uint8_t>& data, std::string& error)
+    {
+        return disassemble_data(*disassemblers.at(worker), cache, data.data(), data.size(), error);
+    });
 }
 
-void disassemble_file(lui::disassembler& disassembler, std::string file)
+auto decompile_dir(const disassembler_factory& disasm_factory, const decompiler_factory& decomp_factory,
+    utils::cache* cache, const std::filesystem::path& dir_path) -> int
+{
+    auto entries = collect_batch(dir_path);
+
+    if (entries.empty())
+        return 0;
+
+    utils::thread_pool pool;
+    std::vector<std::unique_ptr<lui::disassembler>> disassemblers;
+    std::vector<std::unique_ptr<lui::decompiler>> decompilers;
+
+    for (auto i = 0u; i < pool.size(); i++)
+    {
+        disassemblers.push_back(disasm_factory());
+        decompilers.push_back(decomp_factory());
+    }
+
+    return run_pipeline("decompiled", ".lua", entries, pool, cache, [&](std::size_t worker,
+        const std::vector<std::uint8_t>& data, std::string& error)
+    {
+        return decompile_data(*disassemblers.at(worker), *decompilers.at(worker), cache, data.data(), data.size(),
+            error);
+    });
+}
+
+using chunk_filter = std::function<auto(const std::uint8_t* data, std::size_t size) -> bool>;
+
+// disassembles every chunk packed in a blob (a fastfile or zone dump) where it
+// lies in the mapping, without extracting it first. chunks are found by their
+// signature and each one runs to the next, the disassembler stops where its
+// own data ends. outputs go to <blob>_chunks/<offset>.luasm
+auto scan_blob(const disassembler_factory& factory, const chunk_filter& is_chunk, utils::cache* cache,
+    const std::string& file) -> int
+{
+    auto blob = utils::mapped_file(file);
+    auto out_dir = file + "_chunks";
+
+    if (!blob.error().empty())
+    {
+        printf("[ERROR] %s: %s\n", file.data(), blob.error().data());
+        return 1;
+    }
+
+    utils::thread_pool pool;
+    std::vector<std::unique_ptr<lui::disassembler>> disassemblers;
+
+    for (auto i = 0u; i < pool.size(); i++)
+    {
+        disassemblers.push_back(factory());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto found = utils::search::find_all(pool, blob.data(), blob.size(), "\x1BLua"sv);
+
+    std::vector<std::size_t> offsets;
+
+    for (auto offset : found)
+    {
+        if (is_chunk(blob.data() + offset, blob.size() - offset)) offsets.push_back(offset);
+    }
+
+    printf("found %zu chunks in %zu bytes (%zu false signatures)\n", offsets.size(), blob.size(),
+        found.size() - offsets.size());
+
+    if (offsets.empty())
+        return 0;
+
+    std::filesystem::create_directories(out_dir);
+
+    std::vector<batch_entry> entries;
+
+    for (auto i = 0u; i < offsets.size(); i++)
+    {
+        auto end = (i + 1 < offsets.size()) ? offsets[i + 1] : blob.size();
+        entries.push_back({ utils::string::va("%s/%08zX.luasm", out_dir.data(), offsets[i]), end - offsets[i], 0.0, {} });
+    }
+
+    pool.run(entries.size(), [&](std::size_t worker, std::size_t index)
+    {
+        auto& entry = entries.at(index);
+        auto begin = std::chrono::steady_clock::now();
+
+        auto output = disassemble_data(*disassemblers.at(worker), cache, blob.data() + offsets[index], entry.size,
+            entry.error);
+
+        if (entry.error.empty() && !utils::file::save(entry.file, output)) entry.error = "couldn't write file";
+
+        entry.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    });
+
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto failed = print_failures(entries);
+
+    print_batch_report("disassembled", entries, pool.size(), time);
+
+    if (failed != 0) printf("%zu chunks failed\n", failed);
+
+    if (cache != nullptr) cache->print_stats();
+
+    return (failed == 0) ? 0 : 1;
+}
+
+// first differing byte between the original and the reassembled file, empty when identical
+auto compare_output(lui::assembler& assembler, const char* stage, const std::uint8_t* data, std::size_t size,
+    const std::vector<std::uint8_t>& output) -> std::string
+{
+    auto count = std::min(size, output.size());
+    auto diff = std::mismatch(data, data + count, output.data()).first - data;
+
+    if (std::size_t(diff) == count)
+    {
+        if (size == output.size()) return {};
+
+        return utils::string::va("%s: size %zu, expected %zu (%s)", stage, output.size(), size,
+            assembler.locate(count).data());
+    }
+
+    return utils::string::va("%s: mismatch at 0x%zX (%s), got %02X, expected %02X", stage, std::size_t(diff),
+        assembler.locate(diff).data(), output[diff], data[diff]);
+}
+
+// disassembles and reassembles through the in-memory file, the text listing and a binary image
+auto verify_buffer(lui::disassembler& disassembler, lui::assembler& assembler, const std::uint8_t* data,
+    std::size_t size) -> std::string
+{
+    if (!disassembler.disassemble(data, size)) return "disassemble: " + disassembler.error();
+
+    assembler.assemble(disassembler.output_d());
+
+    auto error = compare_output(assembler, "file", data, size, assembler.output());
+
+    if (!error.empty()) return error;
+
+    disassembler.disassemble(data, size);
+    auto listing = disassembler.output();
+
+    if (!disassembler.error().empty()) return "listing: " + disassembler.error();
+
+    assembler.assemble(listing);
+
+    error = compare_output(assembler, "listing", data, size, assembler.output());
+
+    if (!error.empty()) return error;
+
+    disassembler.disassemble(data, size);
+    auto written = lui::image::write(*disassembler.output_d());
+    lui::image image(written);
+    auto file = image.load();
+
+    if (file == nullptr) return "image: " + image.error();
+
+    assembler.assemble(std::move(file));
+
+    return compare_output(assembler, "image", data, size, assembler.output());
+}
+
+auto verify_file(const disassembler_factory& disasm_factory, const assembler_factory& asm_factory,
+    const std::string& file) -> int
+{
+    auto entries = std::filesystem::is_directory(file) ? collect_batch(file) :
+        std::vector<batch_entry> { { file, std::filesystem::file_size(file), 0.0, {} } };
+
+    utils::thread_pool pool(std::min(utils::thread_pool::concurrency(), std::max<std::size_t>(entries.size(), 1)));
+    std::vector<std::unique_ptr<lui::disassembler>> disassemblers;
+    std::vector<std::unique_ptr<lui::assembler>> assemblers;
+
+    for (auto i = 0u; i < pool.size(); i++)
+    {
+        disassemblers.push_back(disasm_factory());
+        assemblers.push_back(asm_factory());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    pool.run(entries.size(), [&](std::size_t worker, std::size_t index)
+    {
+        auto& entry = entries.at(index);
+        auto begin = std::chrono::steady_clock::now();
+
+        auto data = utils::mapped_file(entry.file);
+
+        entry.error = data.error().empty() ? verify_buffer(*disassemblers.at(worker), *assemblers.at(worker),
+            data.data(), data.size()) : data.error();
+        entry.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    });
+
+    auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto failed = print_failures(entries);
+
+    print_batch_report("verified", entries, pool.size(), time);
+    printf("%zu passed, %zu failed\n", entries.size() - failed, failed);
+
+    return (failed == 0) ? 0 : 1;
+}
+
+auto disassemble_file(const disassembler_factory& factory, utils::cache* cache, const std::string& file) -> int
 {
     if(std::filesystem::is_directory(file))
     {
-        disassemble_dir(disassembler, file);
-        return;
+        return disassemble_dir(factory, cache, file);
     }
 
-    const auto ext = std::string(".luac");
-    const auto extpos = file.find(ext);
-    
-    if (extpos != std::string::npos)
+    auto disassembler = factory();
+    auto name = strip_extension(file, ".luac");
+    auto data = utils::mapped_file(name + ".luac");
+
+    if (!data.error().empty())
     {
-        file.replace(extpos, ext.length(), "");
+        printf("[ERROR] %s.luac: %s\n", name.data(), data.error().data());
+        return 1;
     }
 
-    auto data = utils::file::read(file + ".luac");
+    auto error = std::string();
+    auto output = disassemble_data(*disassembler, cache, data.data(), data.size(), error);
 
-    disassembler.disassemble(data);
-    
-    utils::file::save(file + ".luasm", disassembler.output());
+    if (!error.empty())
+    {
+        printf("[ERROR] DISASSEMBLER: %s.luac: %s\n", name.data(), error.data());
+        return 1;
+    }
+
+    if (!utils::file::save(name + ".luasm", output))
+    {
+        printf("[ERROR] %s.luasm: couldn't write file\n", name.data());
+        return 1;
+    }
+
+    return 0;
 }
 
-void decompile_file(lui::disassembler& disassembler, lui::decompiler& decompiler, std::string file)
+auto decompile_file(const disassembler_factory& disasm_factory, const decompiler_factory& decomp_factory,
+    utils::cache* cache, const std::string& file) -> int
 {
     if(std::filesystem::is_directory(file))
     {
-        disassemble_dir(disassembler, file);
-        return;
+        return decompile_dir(disasm_factory, decomp_factory, cache, file);
     }
 
-    const auto ext = std::string(".luac");
-    const auto extpos = file.find(ext);
-    
-    if (extpos != std::string::npos)
+    auto disassembler = disasm_factory();
+    auto decompiler = decomp_factory();
+    auto name = strip_extension(file, ".luac");
+    auto data = utils::mapped_file(name + ".luac");
+
+    if (!data.error().empty())
     {
-        file.replace(extpos, ext.length(), "");
+        printf("[ERROR] %s.luac: %s\n", name.data(), data.error().data());
+        return 1;
     }
 
-    auto data = utils::file::read(file + ".luac");
+    auto error = std::string();
+    auto output = decompile_data(*disassembler, *decompiler, cache, data.data(), data.size(), error);
+
+    if (!error.empty())
+    {
+        printf("[ERROR] %s.luac: %s\n", name.data(), error.data());
+        return 1;
+    }
 
-    disassembler.disassemble(data);
+    if (!utils::file::save(name + ".lua", output))
+    {
+        printf("[ERROR] %s.lua: couldn't write file\n", name.data());
+        return 1;
+    }
 
-    decompiler.decompile(disassembler.output_d());
-    
-    utils::file::save(file + ".lua", decompiler.output());
+    return 0;
 }
 
-int parse_flags(int argc, char** argv, game& game, mode& mode)
+int parse_flags(int argc, char** argv, game& game, mode& mode, options& options)
 {
-    if (argc != 4) return 1;
+    if (argc < 4) return 1;
 
     std::string arg = utils::string::to_lower(argv[1]);
 
@@ -166,12 +674,39 @@ int parse_flags(int argc, char** argv, game& game, mode& mode)
     {
         mode = mode::DECOMP;
     }
+    else if(arg == "-verify")
+    {
+        mode = mode::VERIFY;
+    }
+    else if(arg == "-scan")
+    {
+        mode = mode::SCAN;
+    }
     else
     {
         printf("Unknown mode \"%s\".\n\n", argv[2]);
         return 1;
     }
 
+    for (auto i = 3; i < argc - 1; i++)
+    {
+        arg = utils::string::to_lower(argv[i]);
+
+        if (arg == "-cache" && i + 1 < argc - 1)
+        {
+            options.cache_dir = argv[++i];
+        }
+        else if (arg == "-cache-size" && i + 1 < argc - 1)
+        {
+            options.cache_size = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            printf("Unknown option \"%s\".\n\n", argv[i]);
+            return 1;
+        }
+    }
+
     return 0;
 }
 
@@ -180,15 +715,24 @@ int main(int argc, char** argv)
     std::string file = argv[argc - 1];
     mode mode = mode::__;
     game game = game::__;
+    options options;
 
-    if (parse_flags(argc, argv, game, mode))
+    if (parse_flags(argc, argv, game, mode, options))
     {
-        printf("usage: lui-tool.exe <game> <mode> <file>\n");
+        printf("usage: lui-tool.exe <game> <mode> [options] <file>\n");
         printf("	- games: -iw6\n");
-        printf("	- modes: -disasm\n");
+        printf("	- modes: -asm, -disasm, -decomp, -verify, -scan\n");
+        printf("	- options: -cache <dir>, -cache-size <MiB>\n");
         return 0;
     }
 
+    std::unique_ptr<utils::cache> cache;
+
+    if (!options.cache_dir.empty())
+    {
+        cache = std::make_unique<utils::cache>(options.cache_dir, options.cache_size * 1024 * 1024, cache_version());
+    }
+
     if (mode == mode::ASM)
     {
         if (game == game::IW6)
@@ -201,17 +745,30 @@ int main(int argc, char** argv)
     {
         if (game == game::IW6)
         {
-            IW6::disassembler disassembler;
-            disassemble_file(disassembler, file);
+            return disassemble_file([] { return std::make_unique<IW6::disassembler>(); }, cache.get(), file);
         }
     }
     else if(mode == mode::DECOMP)
     {
         if (game == game::IW6)
         {
-            IW6::disassembler disassembler;
-            IW6::decompiler decompiler;
-            decompile_file(disassembler, decompiler, file);
+            return decompile_file([] { return std::make_unique<IW6::disassembler>(); },
+                [] { return std::make_unique<IW6::decompiler>(); }, cache.get(), file);
+        }
+    }
+    else if(mode == mode::VERIFY)
+    {
+        if (game == game::IW6)
+        {
+            return verify_file([] { return std::make_unique<IW6::disassembler>(); },
+                [] { return std::make_unique<IW6::assembler>(); }, file);
+        }
+    }
+    else if(mode == mode::SCAN)
+    {
+        if (game == game::IW6)
+        {
+            return scan_blob([] { return std::make_unique<IW6::disassembler>(); }, IW6::is_chunk, cache.get(), file);
         }
     }
 
@@ -9,12 +9,17 @@
 #include <utils.hpp>
 #include <IW6.hpp>
 
+// part of every cache key, together with a hash of the executable
+constexpr std::string_view tool_version = "lui-tool 1.1.0";
+
 enum class mode
 {
     __,
     ASM,
     DISASM,
     DECOMP,
+    VERIFY,
+    SCAN,
 };
 
 enum class game
@@ -12,9 +12,12 @@ namespace lui
 class assembler
 {
 public:
+    virtual ~assembler() = default;
+
     virtual auto output() -> std::vector<std::uint8_t> = 0;
     virtual void assemble(std::vector<std::uint8_t>& data) = 0;
     virtual void assemble(lui::file_ptr data) = 0;
+    virtual auto locate(std::size_t offset) -> std::string = 0;
 };
 
 } // namespace lui
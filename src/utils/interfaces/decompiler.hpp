@@ -12,8 +12,13 @@ namespace lui
 class decompiler
 {
 public:
+    virtual ~decompiler() = default;
+
     virtual auto output() -> std::vector<std::uint8_t> = 0;
-    virtual void decompile(lui::file_ptr file) = 0;
+    // false when the file uses an instruction it can't turn into source,
+    // error() tells why
+    virtual auto decompile(lui::file_ptr file) -> bool = 0;
+    virtual auto error() -> const std::string& = 0;
 };
 
 } // namespace lui
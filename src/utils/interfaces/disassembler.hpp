@@ -12,9 +12,15 @@ namespace lui
 class disassembler
 {
 public:
+    virtual ~disassembler() = default;
+
+    // the listing, error() is set when an instruction has no listing form
     virtual auto output() -> std::vector<std::uint8_t> = 0;
     virtual auto output_d() -> lui::file_ptr = 0;
-    virtual void disassemble(std::vector<std::uint8_t>& data) = 0;
+    // false when the data is not a valid file, error() tells why
+    virtual auto disassemble(std::vector<std::uint8_t>& data) -> bool = 0;
+    virtual auto disassemble(const std::uint8_t* data, std::size_t size) -> bool = 0;
+    virtual auto error() -> const std::string& = 0;
 };
 
 } // namespace lui
@@ -33,7 +33,7 @@ enum class t
 
     void to_literal()
     {
-        for(auto i = 0; i < value_.size(); i++)
+        for(auto i = 0u; i < value_.size(); i++)
         {
             if(value_.at(i) == '"')
             {
@@ -45,46 +45,120 @@ enum class t
     }
 };
 
+// typed constant, strings are views into the file's string pool
 struct kst
 {
-    data data_;
+    data::t type_;
+    float number_;
+    bool boolean_;
+    std::string_view string_;
 
-    kst(data::t type, const std::string& value): data_(data(type, value)) {}
+    kst() : type_(data::t::NIL), number_(0.0f), boolean_(false) {}
 
-    auto print() -> std::string
+    static auto nil() -> kst
+    {
+        return kst();
+    }
+
+    static auto boolean(bool value) -> kst
+    {
+        auto k = kst();
+        k.type_ = data::t::BOOLEAN;
+        k.boolean_ = value;
+        return k;
+    }
+
+    static auto number(float value) -> kst
+    {
+        auto k = kst();
+        k.type_ = data::t::NUMBER;
+        k.number_ = value;
+        return k;
+    }
+
+    static auto string(std::string_view value) -> kst
     {
-        return "KST(" + data_.value_ + ")";
+        auto k = kst();
+        k.type_ = data::t::STRING;
+        k.string_ = value;
+        return k;
     }
 
-    auto to_node() -> lui::node_ptr
+    // shortest text that reads back to the same float
+    static auto number_text(float value) -> std::string
     {
-        switch(data_.type_)
+        char buf[32];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        return std::string(buf, res.ptr);
+    }
+
+    auto text() const -> std::string
+    {
+        switch(type_)
+        {
+            case data::t::BOOLEAN: return boolean_ ? "true" : "false";
+            case data::t::NUMBER: return number_text(number_);
+            case data::t::STRING: return std::string(string_);
+            default: return "nil";
+        }
+    }
+
+    // string as a quoted lua literal
+    auto literal() const -> std::string
+    {
+        std::string value;
+        value.reserve(string_.size() + 2);
+        value += '"';
+
+        for(auto c : string_)
+        {
+            if(c == '"') value += '\\';
+            value += c;
+        }
+
+        value += '"';
+        return value;
+    }
+
+    auto print() const -> std::string
+    {
+        return "KST(" + text() + ")";
+    }
+
+    auto to_node(utils::arena& arena) const -> lui::node_ptr
+    {
+        switch(type_)
         {
             case data::t::NIL:
-                return std::make_shared<lui::node_nil>();
+                return arena.make<lui::node_nil>();
                 break;
             case data::t::BOOLEAN:
-                return std::make_shared<lui::node_boolean>((data_.value_ == "true") ? true : false);
+                return arena.make<lui::node_boolean>(boolean_);
                 break;
             case data::t::NUMBER:
-                return std::make_shared<lui::node_number>(data_.value_);
+                return arena.make<lui::node_number>(number_text(number_));
                 break;
             case data::t::STRING:
-                if(data_.value_.size() == 0)
-                {
-                    data_.to_literal();
-                    return std::make_shared<lui::node_string>(data_.value_);
-                }
-                if(data_.value_.at(0) == '\"')
-                    return std::make_shared<lui::node_string>(data_.value_);
+                if(string_.size() == 0)
+                    return arena.make<lui::node_string>(literal());
+                if(string_.at(0) == '\"')
+                    return arena.make<lui::node_string>(std::string(string_));
                 else
-                    return std::make_shared<lui::node_identifier>(data_.value_);                
+                    return arena.make<lui::node_identifier>(std::string(string_));
                 break;
             default:
                 LOG_ERROR("constant node type not supported");
                 break;
         }
     }
+
+    auto to_literal_node(utils::arena& arena) const -> lui::node_ptr
+    {
+        if(type_ == data::t::STRING)
+            return arena.make<lui::node_string>(literal());
+
+        return to_node(arena);
+    }
 };
 
 struct reg
@@ -108,11 +182,11 @@ struct type_info
     type_info(std::uint32_t id, const std::string& name) : id(id), name(name) {}
 };
 
+// decoded view of one instruction word, functions only store the raw words
 struct instruction
 {
     std::uint32_t index;
     std::uint32_t value;
-    std::string data;
 
     std::uint8_t OP;
     std::uint32_t A;
@@ -136,7 +210,8 @@ struct function
     std::uint32_t register_count;       // -- maximum stack size
     // List instructions
     std::uint64_t instruction_count;
-    std::vector<std::unique_ptr<instruction>> instructions;
+    std::uint32_t code_offset;          // file offset of code[0], labels are keyed on it
+    std::vector<std::uint32_t> code;
     // List constants
     std::uint32_t constant_count;
     std::vector<kst> constants;
@@ -148,6 +223,7 @@ struct function
     // ----------------------------------------------------------    
     std::string name;
     std::vector<std::string> params;
+    std::vector<std::string> upvals;    // names the parent's CLOSURE gave the upvalues
     std::vector<lui::node_ptr> stack;
     function_ptr node;
     std::map<std::uint32_t, std::string> labels;
@@ -170,13 +246,21 @@ struct header
     std::vector<type_info> types;
 };
 
+struct prototype
+{
+    std::uint32_t head_mismatch;        // 0x01
+    std::uint32_t unk1;                 // 0x00
+    std::uint32_t unk2;                 // 0x00
+};
+
 struct file
 {
     header header;
     function main;
+    lui::prototype prototype;
+    utils::string_pool_ptr strings;
 };
 
-using instruction_ptr = std::unique_ptr<instruction>;
 using file_ptr = std::unique_ptr<file>;
 
 } // namespace lui
@@ -0,0 +1,461 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace lui
+{
+
+namespace
+{
+
+// appends 4 byte aligned blocks and patches records in place by offset.
+// strings collect in a region of their own that goes last
+class image_writer
+{
+    std::vector<std::uint8_t> data_;
+    std::vector<std::uint8_t> strings_;
+    std::unordered_map<std::string_view, std::uint32_t> refs_;
+
+public:
+    auto reserve(std::size_t size) -> std::uint32_t
+    {
+        auto offset = data_.size();
+
+        if (offset + size > 0xFFFFFFFF)
+        {
+            LOG_ERROR("image larger than 4 GiB");
+        }
+
+        data_.resize(offset + ((size + 3) & ~std::size_t(3)));
+        return static_cast<std::uint32_t>(offset);
+    }
+
+    auto append(const void* data, std::size_t size) -> std::uint32_t
+    {
+        auto offset = this->reserve(size);
+        if (size > 0) std::memcpy(data_.data() + offset, data, size);
+        return offset;
+    }
+
+    template <typename T>
+    void put(std::uint32_t offset, const T& value)
+    {
+        std::memcpy(data_.data() + offset, &value, sizeof(T));
+    }
+
+    // the views must outlive the writer
+    auto string(std::string_view value) -> std::uint32_t
+    {
+        auto it = refs_.find(value);
+
+        if (it != refs_.end()) return it->second;
+
+        auto ref = static_cast<std::uint32_t>(strings_.size());
+        auto length = static_cast<std::uint32_t>(value.size());
+
+        strings_.resize(ref + ((sizeof(length) + value.size() + 1 + 3) & ~std::size_t(3)));
+        std::memcpy(strings_.data() + ref, &length, sizeof(length));
+        std::memcpy(strings_.data() + ref + sizeof(length), value.data(), value.size());
+
+        refs_.insert({ value, ref });
+        return ref;
+    }
+
+    auto finish(image::header_record& header) -> std::vector<std::uint8_t>
+    {
+        header.strings = this->append(strings_.data(), strings_.size());
+        header.strings_size = static_cast<std::uint32_t>(strings_.size());
+        header.size = static_cast<std::uint32_t>(data_.size());
+        this->put(0, header);
+
+        return std::move(data_);
+    }
+};
+
+} // namespace
+
+image::image(const std::uint8_t* data, std::size_t size) : data_(data), size_(size)
+{
+    if (!is_image(data, size))
+    {
+        this->fail(utils::string::va("not a lui image, or not of version %u", version));
+    }
+    else if (reinterpret_cast<std::uintptr_t>(data) % alignof(header_record) != 0)
+    {
+        this->fail(utils::string::va("lui image not aligned to %zu bytes", alignof(header_record)));
+    }
+    else if (this->header().size > size)
+    {
+        this->fail(utils::string::va("lui image truncated, %zu of %u bytes", size, this->header().size));
+    }
+}
+
+image::image(const std::vector<std::uint8_t>& data) : image(data.data(), data.size()) {}
+
+auto image::write(const lui::file& file) -> std::vector<std::uint8_t>
+{
+    image_writer out;
+
+    std::vector<const lui::function*> funcs = { &file.main };
+
+    for (auto i = 0u; i < funcs.size(); i++)
+    {
+        for (const auto& sub : funcs[i]->sub_funcs)
+        {
+            funcs.push_back(&sub);
+        }
+    }
+
+    header_record header {};
+    header.signature = signature;
+    header.version = version;
+    header.magic = file.header.magic;
+    header.lua_version = file.header.lua_version;
+    header.format_version = file.header.format_version;
+    header.endianness = file.header.endianness;
+    header.size_of_int = file.header.size_of_int;
+    header.size_of_size_t = file.header.size_of_size_t;
+    header.size_of_intruction = file.header.size_of_intruction;
+    header.size_of_lua_number = file.header.size_of_lua_number;
+    header.integral_flag = file.header.integral_flag;
+    header.build_flags = file.header.build_flags;
+    header.referenced_mode = file.header.referenced_mode;
+    header.head_mismatch = file.prototype.head_mismatch;
+    header.unk1 = file.prototype.unk1;
+    header.unk2 = file.prototype.unk2;
+
+    out.reserve(sizeof(header_record));
+    header.type_count = static_cast<std::uint32_t>(file.header.types.size());
+    header.types = out.reserve(header.type_count * sizeof(type_record));
+    header.function_count = static_cast<std::uint32_t>(funcs.size());
+    header.functions = out.reserve(header.function_count * sizeof(function_record));
+
+    for (auto i = 0u; i < header.type_count; i++)
+    {
+        const auto& type = file.header.types[i];
+        out.put(header.types + i * sizeof(type_record), type_record { type.id, out.string(type.name) });
+    }
+
+    std::vector<constant_record> constants;
+    std::vector<label_record> labels;
+    std::vector<std::uint32_t> names;
+    auto next = 1u;
+
+    for (auto i = 0u; i < funcs.size(); i++)
+    {
+        const auto& func = *funcs[i];
+        function_record record {};
+
+        record.upval_count = func.upval_count;
+        record.param_count = func.param_count;
+        record.vararg_flags = func.vararg_flags;
+        record.register_count = func.register_count;
+        record.code_offset = func.code_offset;
+        record.debug = func.debug;
+        record.name = out.string(func.name);
+        record.code_count = static_cast<std::uint32_t>(func.code.size());
+        record.code = out.append(func.code.data(), func.code.size() * sizeof(std::uint32_t));
+
+        constants.clear();
+
+        for (const auto& k : func.constants)
+        {
+            switch (k.type_)
+            {
+            case data::t::BOOLEAN:
+                constants.push_back({ std::uint32_t(k.type_), k.boolean_ ? 1u : 0u });
+                break;
+            case data::t::NUMBER:
+            {
+                std::uint32_t bits;
+                std::memcpy(&bits, &k.number_, sizeof(bits));
+                constants.push_back({ std::uint32_t(k.type_), bits });
+                break;
+            }
+            case data::t::STRING:
+                constants.push_back({ std::uint32_t(k.type_), out.string(k.string_) });
+                break;
+            default:
+                constants.push_back({ std::uint32_t(k.type_), 0 });
+                break;
+            }
+        }
+
+        record.constant_count = static_cast<std::uint32_t>(constants.size());
+        record.constants = out.append(constants.data(), constants.size() * sizeof(constant_record));
+
+        labels.clear();
+
+        for (const auto& [offset, name] : func.labels)
+        {
+            labels.push_back({ offset, out.string(name) });
+        }
+
+        record.label_count = static_cast<std::uint32_t>(labels.size());
+        record.labels = out.append(labels.data(), labels.size() * sizeof(label_record));
+
+        names.clear();
+        for (const auto& name : func.params) names.push_back(out.string(name));
+        record.param_name_count = static_cast<std::uint32_t>(names.size());
+        record.params = out.append(names.data(), names.size() * sizeof(std::uint32_t));
+
+        names.clear();
+        for (const auto& name : func.upvals) names.push_back(out.string(name));
+        record.upval_name_count = static_cast<std::uint32_t>(names.size());
+        record.upvals = out.append(names.data(), names.size() * sizeof(std::uint32_t));
+
+        record.first_sub = next;
+        record.sub_count = static_cast<std::uint32_t>(func.sub_funcs.size());
+        next += record.sub_count;
+
+        out.put(header.functions + i * sizeof(function_record), record);
+    }
+
+    return out.finish(header);
+}
+
+auto image::is_image(const std::uint8_t* data, std::size_t size) -> bool
+{
+    if (size < sizeof(header_record)) return false;
+
+    header_record header;
+    std::memcpy(&header, data, sizeof(header));
+
+    return header.signature == signature && header.version == version;
+}
+
+auto image::header() const -> const header_record&
+{
+    return *reinterpret_cast<const header_record*>(data_);
+}
+
+auto image::function_count() const -> std::uint32_t
+{
+    return this->header().function_count;
+}
+
+auto image::function(std::uint32_t index) const -> const function_record*
+{
+    if (index >= this->function_count())
+    {
+        this->fail(utils::string::va("lui image function %u out of range", index));
+        return nullptr;
+    }
+
+    auto records = this->array<function_record>(this->header().functions, this->function_count());
+
+    return (records != nullptr) ? &records[index] : nullptr;
+}
+
+auto image::code(const function_record& func) const -> const std::uint32_t*
+{
+    return this->array<std::uint32_t>(func.code, func.code_count);
+}
+
+auto image::constants(const function_record& func) const -> const constant_record*
+{
+    return this->array<constant_record>(func.constants, func.constant_count);
+}
+
+auto image::string(std::uint32_t ref) const -> std::string_view
+{
+    const auto& header = this->header();
+    auto region = this->array<char>(header.strings, header.strings_size);
+
+    if (region == nullptr) return {};
+
+    return this->find_string(std::string_view(region, header.strings_size), ref);
+}
+
+auto image::error() const -> const std::string&
+{
+    return error_;
+}
+
+auto image::load(utils::string_pool_ptr strings) const -> file_ptr
+{
+    if (!error_.empty()) return nullptr;
+
+    const auto& header = this->header();
+    auto result = std::make_unique<file>();
+
+    result->strings = (strings != nullptr) ? strings : std::make_shared<utils::string_pool>();
+    result->header.magic = header.magic;
+    result->header.lua_version = header.lua_version;
+    result->header.format_version = header.format_version;
+    result->header.endianness = header.endianness;
+    result->header.size_of_int = header.size_of_int;
+    result->header.size_of_size_t = header.size_of_size_t;
+    result->header.size_of_intruction = header.size_of_intruction;
+    result->header.size_of_lua_number = header.size_of_lua_number;
+    result->header.integral_flag = header.integral_flag;
+    result->header.build_flags = header.build_flags;
+    result->header.referenced_mode = header.referenced_mode;
+    result->header.type_count = header.type_count;
+    result->prototype.head_mismatch = header.head_mismatch;
+    result->prototype.unk1 = header.unk1;
+    result->prototype.unk2 = header.unk2;
+
+    // the strings are distinct already, so the region is copied as is
+    // instead of interning them one at a time
+    auto region = this->array<char>(header.strings, header.strings_size);
+    auto types = this->array<type_record>(header.types, header.type_count);
+
+    if (region == nullptr || types == nullptr) return nullptr;
+
+    auto copy = result->strings->store(std::string_view(region, header.strings_size));
+
+    result->header.types.reserve(header.type_count);
+
+    for (auto i = 0u; i < header.type_count; i++)
+    {
+        result->header.types.push_back(type_info(types[i].id, std::string(this->find_string(copy, types[i].name))));
+    }
+
+    if (!this->load_function(copy, 0, 0, result->main) || !error_.empty()) return nullptr;
+
+    return result;
+}
+
+void image::fail(std::string message) const
+{
+    if (error_.empty()) error_ = std::move(message);
+}
+
+template <typename T>
+auto image::array(std::uint32_t offset, std::uint32_t count) const -> const T*
+{
+    if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T))
+    {
+        this->fail(utils::string::va("lui image record out of bounds at 0x%X", offset));
+        return nullptr;
+    }
+
+    return reinterpret_cast<const T*>(data_ + offset);
+}
+
+// a string of the region, with its terminator inside it. empty when ref is
+// out of bounds, which marks the image failed
+auto image::find_string(std::string_view strings, std::uint32_t ref) const -> std::string_view
+{
+    std::uint32_t length;
+
+    if (ref % 4 != 0 || ref > strings.size() || strings.size() - ref < sizeof(length))
+    {
+        this->fail(utils::string::va("lui image string out of bounds at 0x%X", ref));
+        return {};
+    }
+
+    std::memcpy(&length, strings.data() + ref, sizeof(length));
+
+    if (length >= strings.size() - ref - sizeof(length))
+    {
+        this->fail(utils::string::va("lui image string out of bounds at 0x%X", ref));
+        return {};
+    }
+
+    return strings.substr(ref + sizeof(length), length);
+}
+
+// false when a record it needs is out of bounds, bad strings only mark the
+// image failed and are checked once at the end
+auto image::load_function(std::string_view strings, std::uint32_t index, std::uint32_t depth,
+    lui::function& func) const -> bool
+{
+    if (depth > max_depth)
+    {
+        this->fail(utils::string::va("lui image function %u nested deeper than %u", index, max_depth));
+        return false;
+    }
+
+    auto found = this->function(index);
+
+    if (found == nullptr) return false;
+
+    const auto& record = *found;
+
+    func.upval_count = record.upval_count;
+    func.param_count = record.param_count;
+    func.vararg_flags = static_cast<std::uint8_t>(record.vararg_flags);
+    func.register_count = record.register_count;
+    func.code_offset = record.code_offset;
+    func.debug = record.debug;
+    func.name = std::string(this->find_string(strings, record.name));
+
+    auto code = this->code(record);
+    auto constants = this->constants(record);
+    auto labels = this->array<label_record>(record.labels, record.label_count);
+    auto params = this->array<std::uint32_t>(record.params, record.param_name_count);
+    auto upvals = this->array<std::uint32_t>(record.upvals, record.upval_name_count);
+
+    if (code == nullptr || constants == nullptr || labels == nullptr || params == nullptr || upvals == nullptr)
+        return false;
+
+    func.instruction_count = record.code_count;
+    func.code.assign(code, code + record.code_count);
+    func.constant_count = record.constant_count;
+    func.constants.reserve(record.constant_count);
+
+    for (auto i = 0u; i < record.constant_count; i++)
+    {
+        const auto& k = constants[i];
+
+        switch (data::t(k.type))
+        {
+        case data::t::BOOLEAN:
+            func.constants.push_back(kst::boolean(k.value != 0));
+            break;
+        case data::t::NUMBER:
+        {
+            float value;
+            std::memcpy(&value, &k.value, sizeof(value));
+            func.constants.push_back(kst::number(value));
+            break;
+        }
+        case data::t::STRING:
+            func.constants.push_back(kst::string(this->find_string(strings, k.value)));
+            break;
+        default:
+            func.constants.push_back(kst::nil());
+            break;
+        }
+    }
+
+    for (auto i = 0u; i < record.label_count; i++)
+    {
+        func.labels.insert(func.labels.end(), { labels[i].offset, std::string(this->find_string(strings, labels[i].name)) });
+    }
+
+    for (auto i = 0u; i < record.param_name_count; i++)
+    {
+        func.params.push_back(std::string(this->find_string(strings, params[i])));
+    }
+
+    for (auto i = 0u; i < record.upval_name_count; i++)
+    {
+        func.upvals.push_back(std::string(this->find_string(strings, upvals[i])));
+    }
+
+    // children always come after their parent, so a bad image cannot loop
+    if (record.sub_count > 0 && (record.first_sub <= index || record.first_sub > this->function_count() ||
+        record.sub_count > this->function_count() - record.first_sub))
+    {
+        this->fail(utils::string::va("lui image function %u has children out of range", index));
+        return false;
+    }
+
+    func.sub_func_count = record.sub_count;
+    func.sub_funcs.resize(record.sub_count);
+
+    for (auto i = 0u; i < record.sub_count; i++)
+    {
+        if (!this->load_function(strings, record.first_sub + i, depth + 1, func.sub_funcs[i])) return false;
+    }
+
+    return true;
+}
+
+} // namespace lui
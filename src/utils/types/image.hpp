@@ -0,0 +1,137 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_IMAGE_HPP_
+#define _LUI_IMAGE_HPP_
+
+namespace lui
+{
+
+// binary image of a disassembled file. every record is 4 byte aligned and
+// refers to others by offset from the start of the image, so a mapped image
+// is read in place: opening one checks the header and nothing is decoded
+// until it is asked for. functions are stored breadth first so the children
+// of each one are consecutive, the main function comes first. each distinct
+// string is stored once at the end, as a length followed by the bytes and a
+// terminator, and referred to by its offset in that region.
+class image
+{
+public:
+    static constexpr std::uint32_t signature = 0x5249554C;     // "LUIR"
+    static constexpr std::uint32_t version = 1;
+
+    struct header_record
+    {
+        std::uint32_t signature;
+        std::uint32_t version;
+        std::uint32_t size;             // of the whole image
+        std::uint32_t types;
+        std::uint32_t type_count;
+        std::uint32_t functions;
+        std::uint32_t function_count;
+        std::uint32_t strings;
+        std::uint32_t strings_size;
+        std::uint32_t magic;            // the lui::header fields
+        std::uint8_t lua_version;
+        std::uint8_t format_version;
+        std::uint8_t endianness;
+        std::uint8_t size_of_int;
+        std::uint8_t size_of_size_t;
+        std::uint8_t size_of_intruction;
+        std::uint8_t size_of_lua_number;
+        std::uint8_t integral_flag;
+        std::uint8_t build_flags;
+        std::uint8_t referenced_mode;
+        std::uint8_t pad[2];
+        std::uint32_t head_mismatch;    // the lui::prototype fields
+        std::uint32_t unk1;
+        std::uint32_t unk2;
+    };
+
+    struct type_record
+    {
+        std::uint32_t id;
+        std::uint32_t name;
+    };
+
+    struct function_record
+    {
+        std::uint32_t upval_count;
+        std::uint32_t param_count;
+        std::uint32_t vararg_flags;
+        std::uint32_t register_count;
+        std::uint32_t code_offset;
+        std::uint32_t debug;
+        std::uint32_t name;
+        std::uint32_t code;
+        std::uint32_t code_count;
+        std::uint32_t constants;
+        std::uint32_t constant_count;
+        std::uint32_t labels;
+        std::uint32_t label_count;
+        std::uint32_t params;           // string references
+        std::uint32_t param_name_count;
+        std::uint32_t upvals;
+        std::uint32_t upval_name_count;
+        std::uint32_t first_sub;        // index of the first child
+        std::uint32_t sub_count;
+    };
+
+    // number holds the float bits, boolean 0 or 1, string a string reference
+    struct constant_record
+    {
+        std::uint32_t type;
+        std::uint32_t value;
+    };
+
+    struct label_record
+    {
+        std::uint32_t offset;
+        std::uint32_t name;
+    };
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+    mutable std::string error_;
+
+    // functions are loaded one frame per level, no deeper than the
+    // disassemblers nest them
+    static constexpr std::uint32_t max_depth = 200;
+
+public:
+    image(const std::uint8_t* data, std::size_t size);
+    image(const std::vector<std::uint8_t>& data);
+
+    static auto write(const lui::file& file) -> std::vector<std::uint8_t>;
+    static auto is_image(const std::uint8_t* data, std::size_t size) -> bool;
+
+    // the first thing found wrong with the image, empty while it is sound.
+    // the accessors return null for records out of bounds
+    auto error() const -> const std::string&;
+    auto header() const -> const header_record&;
+    auto function_count() const -> std::uint32_t;
+    auto function(std::uint32_t index) const -> const function_record*;
+    auto code(const function_record& func) const -> const std::uint32_t*;
+    auto constants(const function_record& func) const -> const constant_record*;
+    auto string(std::uint32_t ref) const -> std::string_view;
+
+    // rebuilds the lui::file with bulk copies. the string region goes into
+    // strings when given, into a pool of its own otherwise, with one copy.
+    // null when the image is damaged, error() tells why
+    auto load(utils::string_pool_ptr strings = nullptr) const -> file_ptr;
+
+private:
+    void fail(std::string message) const;
+    template <typename T>
+    auto array(std::uint32_t offset, std::uint32_t count) const -> const T*;
+    auto find_string(std::string_view strings, std::uint32_t ref) const -> std::string_view;
+    auto load_function(std::string_view strings, std::uint32_t index, std::uint32_t depth,
+        lui::function& func) const -> bool;
+};
+
+} // namespace lui
+
+#endif // _LUI_IMAGE_HPP_
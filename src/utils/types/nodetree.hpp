@@ -20,14 +20,30 @@ enum class node_type
     length,
     field,
     method,
+    index,
+    upvalue,
     vararg,
     newtable,
+    entry,
     concat,
     call,
     assign,
     equal,
     not_equal,
+    less,
+    less_equal,
+    op_not,
+    op_and,
+    op_or,
+    binary,
+    unary,
     stmt_return,
+    stmt_if,
+    stmt_while,
+    stmt_repeat,
+    stmt_for,
+    stmt_for_in,
+    stmt_break,
     block,
     parameters,
     function,
@@ -48,14 +64,30 @@ struct node_number;
 struct node_length;
 struct node_field;
 struct node_method;
+struct node_index;
+struct node_upvalue;
 struct node_vararg;
 struct node_newtable;
+struct node_entry;
 struct node_concat;
 struct node_call;
 struct node_assign;
 struct node_equal;
 struct node_not_equal;
+struct node_less;
+struct node_less_equal;
+struct node_not;
+struct node_and;
+struct node_or;
+struct node_binary;
+struct node_unary;
 struct node_return;
+struct node_if;
+struct node_while;
+struct node_repeat;
+struct node_for;
+struct node_for_in;
+struct node_break;
 struct node_block;
 struct node_parameters;
 struct node_function;
@@ -64,67 +96,95 @@ struct node_test;
 struct node_jump;
 struct debug;
 
-using node_ptr = std::shared_ptr<node>;
-using nil_ptr = std::shared_ptr<node_nil>;
-using boolean_ptr = std::shared_ptr<node_boolean>;
-using identifier_ptr = std::shared_ptr<node_identifier>;
-using string_ptr = std::shared_ptr<node_string>;
-using number_ptr = std::shared_ptr<node_number>;
-using length_ptr = std::shared_ptr<node_length>;
-using field_ptr = std::shared_ptr<node_field>;
-using method_ptr = std::shared_ptr<node_method>;
-using vararg_ptr = std::shared_ptr<node_vararg>;
-using newtable_ptr = std::shared_ptr<node_newtable>;
-using concat_ptr = std::shared_ptr<node_concat>;
-using call_ptr = std::shared_ptr<node_call>;
-using assign_ptr = std::shared_ptr<node_assign>;
-using equal_ptr = std::shared_ptr<node_equal>;
-using not_equal_ptr = std::shared_ptr<node_not_equal>;
-using return_ptr = std::shared_ptr<node_return>;
-using block_ptr = std::shared_ptr<node_block>;
-using parameters_ptr = std::shared_ptr<node_parameters>;
-using function_ptr = std::shared_ptr<node_function>;
-using script_ptr = std::shared_ptr<node_script>;
-using test_ptr = std::shared_ptr<node_test>;
-using jump_ptr = std::shared_ptr<node_jump>;
-using debug_ptr = std::shared_ptr<debug>;
-
-union child
-{
-    node_ptr as_node;
-    identifier_ptr as_identifier;
-    string_ptr as_string;
-    number_ptr as_number;
-    length_ptr as_length;
-    field_ptr as_field;
-    method_ptr as_method;
-    vararg_ptr as_vararg;
-    newtable_ptr as_newtable;
-    concat_ptr as_concat;
-    call_ptr as_call;
-    assign_ptr as_assign;
-    equal_ptr as_equal;
-    not_equal_ptr as_not_equal;
-    block_ptr as_block;
-    parameters_ptr as_params;
-    script_ptr as_script;
-    test_ptr as_test;
-    jump_ptr as_jump;
-
-    ~child() {}
-    child() {}
-    child(node_ptr val): as_node(std::move(val)) {}
-    
-    child(child && val)
+using node_ptr = node*;
+using nil_ptr = node_nil*;
+using boolean_ptr = node_boolean*;
+using identifier_ptr = node_identifier*;
+using string_ptr = node_string*;
+using number_ptr = node_number*;
+using length_ptr = node_length*;
+using field_ptr = node_field*;
+using method_ptr = node_method*;
+using index_ptr = node_index*;
+using upvalue_ptr = node_upvalue*;
+using vararg_ptr = node_vararg*;
+using newtable_ptr = node_newtable*;
+using entry_ptr = node_entry*;
+using concat_ptr = node_concat*;
+using call_ptr = node_call*;
+using assign_ptr = node_assign*;
+using equal_ptr = node_equal*;
+using not_equal_ptr = node_not_equal*;
+using less_ptr = node_less*;
+using less_equal_ptr = node_less_equal*;
+using not_ptr = node_not*;
+using and_ptr = node_and*;
+using or_ptr = node_or*;
+using binary_ptr = node_binary*;
+using unary_ptr = node_unary*;
+using return_ptr = node_return*;
+using if_ptr = node_if*;
+using while_ptr = node_while*;
+using repeat_ptr = node_repeat*;
+using for_ptr = node_for*;
+using for_in_ptr = node_for_in*;
+using break_ptr = node_break*;
+using block_ptr = node_block*;
+using parameters_ptr = node_parameters*;
+using function_ptr = node_function*;
+using script_ptr = node_script*;
+using test_ptr = node_test*;
+using jump_ptr = node_jump*;
+using debug_ptr = debug*;
+
+// move-only handle to a child node, the tag is the type of the node it
+// points to. nodes themselves are owned by the decompiler's arena
+struct child
+{
+    union
     {
-        new(&as_node) node_ptr(std::move(val.as_node));
-    }
-
-    child& operator=(child && val)
+        node_ptr as_node;
+        identifier_ptr as_identifier;
+        string_ptr as_string;
+        number_ptr as_number;
+        length_ptr as_length;
+        field_ptr as_field;
+        method_ptr as_method;
+        index_ptr as_index;
+        vararg_ptr as_vararg;
+        newtable_ptr as_newtable;
+        entry_ptr as_entry;
+        concat_ptr as_concat;
+        call_ptr as_call;
+        assign_ptr as_assign;
+        equal_ptr as_equal;
+        not_equal_ptr as_not_equal;
+        not_ptr as_not;
+        binary_ptr as_binary;
+        if_ptr as_if;
+        block_ptr as_block;
+        parameters_ptr as_params;
+        script_ptr as_script;
+        test_ptr as_test;
+        jump_ptr as_jump;
+    };
+
+    child() : as_node(nullptr) {}
+    child(node_ptr val) : as_node(val) {}
+
+    child(const child&) = delete;
+    child& operator=(const child&) = delete;
+
+    child(child&& val) noexcept : as_node(std::exchange(val.as_node, nullptr)) {}
+
+    child& operator=(child&& val) noexcept
     {
-        new(&as_node) node_ptr(std::move(val.as_node));
-        return *(child*)&as_node;
+        as_node = std::exchange(val.as_node, nullptr);
+        return *this;
     }
+
+    auto type() const -> node_type;
+    explicit operator bool() const { return as_node != nullptr; }
 };
 
 struct node
@@ -135,31 +195,24 @@ struct node
     node() : type(node_type::null) {}
     node(node_type type) : type(type) {}
     node(node_type type, const std::string& location) : type(type), location(location) {}
+
+    // nodes stay where the arena put them, only child handles move
+    node(const node&) = delete;
+    node& operator=(const node&) = delete;
     
     virtual ~node() = default;
-    virtual auto print() -> std::string { return ""; };
-     
-protected:
-    static std::uint32_t indent;
-    static void reset_indentation() { indent = 0; }
-    static std::string indented(std::uint32_t indent)
-    {
-        static char buff[100];
-        snprintf(buff, sizeof(buff), "%*s", indent, "");
-        return std::string(buff);
-    }
 };
 
+inline auto child::type() const -> node_type
+{
+    return as_node ? as_node->type : node_type::null;
+}
+
 struct node_nil : public node
 {
     node_nil(const std::string& location) : node(node_type::nil, location) {}
 
     node_nil() : node(node_type::nil) {}
-
-    auto print() -> std::string override
-    {
-        return  "nil";
-    }
 };
 
 struct node_boolean : public node
@@ -169,11 +222,6 @@ struct node_boolean : public node
         : node(node_type::boolean, location), value(value) {}
 
     node_boolean(bool value) : node(node_type::boolean), value(value) {}
-
-    auto print() -> std::string override
-    {
-        return  value ? "true" : "false";
-    }
 };
 
 struct node_identifier : public node
@@ -185,11 +233,6 @@ struct node_identifier : public node
 
     node_identifier(const std::string& value)
         : node(node_type::identifier), value(value) {}
-
-    auto print() -> std::string override
-    {
-        return value;
-    }
 };
 
 struct node_string : public node
@@ -201,11 +244,6 @@ struct node_string : public node
     
     node_string(const std::string& value)
         : node(node_type::string), value(value) {}
-
-    auto print() -> std::string override
-    {
-        return value;
-    }
 };
 
 struct node_number : public node
@@ -217,11 +255,6 @@ struct node_number : public node
 
     node_number(const std::string& value)
         : node(node_type::number), value(std::move(value)) {}
-
-    auto print() -> std::string override
-    {
-        return value;
-    }
 };
 
 struct node_length: public node
@@ -233,11 +266,6 @@ struct node_length: public node
 
     node_length(child obj)
         : node(node_type::length), obj(std::move(obj)) {}
-
-    auto print() -> std::string override
-    {
-        return "#" + obj.as_node->print();
-    }
 };
 
 struct node_field : public node
@@ -250,11 +278,6 @@ struct node_field : public node
 
     node_field(child obj, child field)
         : node(node_type::field), obj(std::move(obj)), field(std::move(field)) {}
-
-    auto print() -> std::string override
-    {
-        return obj.as_node->print() + "." + field.as_node->print();
-    }
 };
 
 struct node_method : public node
@@ -267,11 +290,23 @@ struct node_method : public node
 
     node_method(child obj, child field)
         : node(node_type::method), obj(std::move(obj)), field(std::move(field)) {}
+};
 
-    auto print() -> std::string override
-    {
-        return obj.as_node->print() + ":" + field.as_node->print();
-    }
+// obj[key], for keys that can't be written as a field name
+struct node_index : public node
+{
+    child obj;
+    child key;
+
+    node_index(child obj, child key)
+        : node(node_type::index), obj(std::move(obj)), key(std::move(key)) {}
+};
+
+struct node_upvalue : public node
+{
+    std::string name;
+
+    node_upvalue(const std::string& name) : node(node_type::upvalue), name(name) {}
 };
 
 struct node_vararg : public node
@@ -279,23 +314,32 @@ struct node_vararg : public node
     node_vararg(const std::string& location) : node(node_type::vararg, location) {}
 
     node_vararg() : node(node_type::vararg) {}
-
-    auto print() -> std::string override
-    {
-        return "...";
-    }
 };
 
+// constructor entries in evaluation order, keyed ones as node_entry. items
+// counts the positional ones
 struct node_newtable : public node
 {
+    std::vector<child> list;
+    std::uint32_t items = 0;
+
     node_newtable(const std::string& location) : node(node_type::newtable, location) {}
 
     node_newtable() : node(node_type::newtable) {}
+};
 
-    auto print() -> std::string override
-    {
-        return "{}";
-    }
+// key = value inside a table constructor, [key] = value unless the key is a name
+struct node_entry : public node
+{
+    child key;
+    child value;
+    bool name;
+
+    node_entry(const std::string& location, child key, child value, bool name)
+        : node(node_type::entry, location), key(std::move(key)), value(std::move(value)), name(name) {}
+
+    node_entry(child key, child value, bool name)
+        : node(node_type::entry), key(std::move(key)), value(std::move(value)), name(name) {}
 };
 
 struct node_concat : public node
@@ -305,19 +349,6 @@ struct node_concat : public node
     node_concat(const std::string& location) : node(node_type::concat, location) {}
 
     node_concat() : node(node_type::concat) {}
-
-    auto print() -> std::string override
-    {
-        std::string data;
-
-        for (const auto& param : list)
-        {
-            data += param.as_node->print();
-            if(&param != &list.back()) data += " .. ";
-        }
-
-        return data;
-    }
 };
 
 struct node_call : public node
@@ -328,11 +359,6 @@ struct node_call : public node
     node_call(const std::string& location) : node(node_type::call, location) {}
 
     node_call() : node(node_type::call) {}
-
-    auto print() -> std::string override
-    {
-        return name.as_node->print() + "(" + params.as_node->print() + ")";
-    }
 };
 
 struct node_assign : public node
@@ -345,11 +371,6 @@ struct node_assign : public node
 
     node_assign(child lvalue, child rvalue)
         : node(node_type::assign), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
-
-    auto print() -> std::string override
-    {
-        return lvalue.as_node->print() + " = " + rvalue.as_node->print();
-    }
 };
 
 struct node_not_equal : public node
@@ -362,11 +383,6 @@ struct node_not_equal : public node
 
     node_not_equal(child lvalue, child rvalue)
         : node(node_type::not_equal), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
-
-    auto print() -> std::string override
-    {
-        return lvalue.as_node->print() + " ~= " + rvalue.as_node->print();
-    }
 };
 
 struct node_equal : public node
@@ -379,11 +395,93 @@ struct node_equal : public node
 
     node_equal(child lvalue, child rvalue)
         : node(node_type::equal), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
 
-    auto print() -> std::string override
-    {
-        return lvalue.as_node->print() + " == " + rvalue.as_node->print();
-    }
+struct node_less : public node
+{
+    child lvalue;
+    child rvalue;
+
+    node_less(const std::string& location, child lvalue, child rvalue)
+        : node(node_type::less, location), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+
+    node_less(child lvalue, child rvalue)
+        : node(node_type::less), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
+
+struct node_less_equal : public node
+{
+    child lvalue;
+    child rvalue;
+
+    node_less_equal(const std::string& location, child lvalue, child rvalue)
+        : node(node_type::less_equal, location), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+
+    node_less_equal(child lvalue, child rvalue)
+        : node(node_type::less_equal), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
+
+struct node_and : public node
+{
+    child lvalue;
+    child rvalue;
+
+    node_and(const std::string& location, child lvalue, child rvalue)
+        : node(node_type::op_and, location), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+
+    node_and(child lvalue, child rvalue)
+        : node(node_type::op_and), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
+
+struct node_or : public node
+{
+    child lvalue;
+    child rvalue;
+
+    node_or(const std::string& location, child lvalue, child rvalue)
+        : node(node_type::op_or, location), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+
+    node_or(child lvalue, child rvalue)
+        : node(node_type::op_or), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
+
+struct node_not : public node
+{
+    child obj;
+
+    node_not(const std::string& location, child obj)
+        : node(node_type::op_not, location), obj(std::move(obj)) {}
+
+    node_not(child obj)
+        : node(node_type::op_not), obj(std::move(obj)) {}
+};
+
+enum class binary_op
+{
+    add,
+    sub,
+    mul,
+    div,
+    mod,
+    pow,
+};
+
+struct node_binary : public node
+{
+    binary_op op;
+    child lvalue;
+    child rvalue;
+
+    node_binary(binary_op op, child lvalue, child rvalue)
+        : node(node_type::binary), op(op), lvalue(std::move(lvalue)), rvalue(std::move(rvalue)) {}
+};
+
+// arithmetic negation, not and # have their own nodes
+struct node_unary : public node
+{
+    child obj;
+
+    node_unary(child obj) : node(node_type::unary), obj(std::move(obj)) {}
 };
 
 struct node_return : public node
@@ -393,71 +491,84 @@ struct node_return : public node
     node_return(const std::string& location) : node(node_type::stmt_return, location) {}
 
     node_return() : node(node_type::stmt_return) {}
+};
 
-    auto print() -> std::string override
-    {
-        std::string data;
-
-        data += "return";
-        for(auto& stmt : stmts)
-        {
-            data += " " + stmt.as_node->print();
-            if(&stmt != &stmts.back())
-            {
-                data += ",";
-            }
-        }
-
-        return data;
-    }
+// structured statements recovered from the control-flow graph, an empty
+// else_block means there is no else branch
+struct node_if : public node
+{
+    child cond;
+    child then_block;
+    child else_block;
+
+    node_if(child cond, child then_block)
+        : node(node_type::stmt_if), cond(std::move(cond)), then_block(std::move(then_block)) {}
 };
 
-struct node_block : public node
+struct node_while : public node
 {
-    std::vector<child> stmts;
+    child cond;
+    child block;
 
-    node_block(const std::string& location) : node(node_type::block, location) {}
+    node_while(child cond, child block)
+        : node(node_type::stmt_while), cond(std::move(cond)), block(std::move(block)) {}
+};
 
-    node_block() : node(node_type::block) {}
+struct node_repeat : public node
+{
+    child block;
+    child cond;
 
-    auto print() -> std::string override
-    {
-        std::string data;
+    node_repeat(child block, child cond)
+        : node(node_type::stmt_repeat), block(std::move(block)), cond(std::move(cond)) {}
+};
 
-        std::string pad = indented(indent);
+// numeric for, an empty step is the default of 1
+struct node_for : public node
+{
+    child var;
+    child init;
+    child limit;
+    child step;
+    child block;
 
-        for(auto& stmt : stmts)
-        {
-            data += "\n" + pad + stmt.as_node->print();
-        }
+    node_for(child var, child init, child limit, child step, child block)
+        : node(node_type::stmt_for), var(std::move(var)), init(std::move(init)), limit(std::move(limit)),
+            step(std::move(step)), block(std::move(block)) {}
+};
 
-        return data;
-    }
+struct node_for_in : public node
+{
+    child vars;
+    child list;
+    child block;
+
+    node_for_in(child vars, child list, child block)
+        : node(node_type::stmt_for_in), vars(std::move(vars)), list(std::move(list)), block(std::move(block)) {}
 };
 
-struct node_parameters : public node
+struct node_break : public node
 {
-    std::vector<child> list;
-    bool vararg;
+    node_break() : node(node_type::stmt_break) {}
+};
 
-    node_parameters(const std::string& location) : node(node_type::parameters, location) {}
+struct node_block : public node
+{
+    std::vector<child> stmts;
 
-    node_parameters() : node(node_type::parameters) {}
+    node_block(const std::string& location) : node(node_type::block, location) {}
 
-    auto print() -> std::string override
-    {
-        if(vararg) { return " ... "; }
-    
-        std::string data;
+    node_block() : node(node_type::block) {}
+};
+
+struct node_parameters : public node
+{
+    std::vector<child> list;
+    bool vararg;
 
-        for (const auto& param : list)
-        {
-            data += param.as_node->print();
-            if(&param != &list.back()) data += ", ";
-        }
+    node_parameters(const std::string& location) : node(node_type::parameters, location), vararg(false) {}
 
-        return data;
-    }
+    node_parameters() : node(node_type::parameters), vararg(false) {}
 };
 
 struct node_function : public node
@@ -474,42 +585,6 @@ struct node_function : public node
     node_function(child name, child params, child block)
         : node(node_type::function), name(std::move(name)), params(std::move(params)),
             block(std::move(block)) {}
-
-    auto print() -> std::string override
-    {
-        std::string data;
-
-        if(name.as_node->print() == "_init_")
-        {
-            data += block.as_node->print();
-        
-            for(auto& f : sub_funcs)
-            {
-                data += "\n" + f.as_node->print();
-            }
-        }
-        else
-        {
-            std::string pad = indented(indent);
-
-            data += "\n" + pad + "local function " + name.as_node->print() + "(" + params.as_node->print() + ")";
-
-            indent += 4;
-
-            data += block.as_node->print();
-
-            for(auto& f : sub_funcs)
-            {
-                data += "\n" + f.as_node->print();
-            }
-
-            indent -= 4;
-
-            data += "\n" + pad + "end";
-        }
-        
-        return data;
-    }
 };
 
 struct node_script : public node
@@ -521,11 +596,6 @@ struct node_script : public node
 
     node_script()
         : node(node_type::script) {}
-
-    auto print() -> std::string override
-    {
-        return main.as_node->print() + "\n";
-    }
 };
 
 struct node_test : public node
@@ -538,15 +608,6 @@ struct node_test : public node
 
     node_test(child cond, bool is_not)
         : node(node_type::test), cond(std::move(cond)), is_not(is_not) {}
-
-    auto print() -> std::string override
-    {
-        std::string data;
-        data += "if ";
-        data += (is_not) ? "not " : "";
-        data += cond.as_node->print() + " then";
-        return data;
-    }
 };
 
 struct node_jump : public node
@@ -558,11 +619,6 @@ struct node_jump : public node
 
     node_jump(child loc)
         : node(node_type::jump), loc(std::move(loc)) {}
-
-    auto print() -> std::string override
-    {
-        return "jump(" + loc.as_node->print() + ")";
-    }
 };
 
 struct node_label : public node
@@ -574,11 +630,6 @@ struct node_label : public node
 
     node_label(const std::string& loc)
         : node(node_type::label), loc(std::move(loc)) {}
-
-    auto print() -> std::string override
-    {
-        return "-- " + loc + ":";
-    }
 };
 
 struct node_debug : public node
@@ -586,11 +637,6 @@ struct node_debug : public node
     std::string data;
     
     node_debug(const std::string& data) : node(node_type::debug), data(std::move(data)) {}
-
-    auto print() -> std::string override
-    {
-        return "-- " + data;
-    }
 };
 
 } // namespace lui
@@ -0,0 +1,516 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace lui
+{
+
+printer::printer(utils::text_writer& out, std::uint32_t indent_width)
+    : out_(out), indent_width_(indent_width), depth_(0) {}
+
+void printer::print(const node_script& script)
+{
+    depth_ = 0;
+    this->print(static_cast<const node&>(script));
+}
+
+void printer::print(const node& n)
+{
+    switch (n.type)
+    {
+    case node_type::nil:
+        out_.write("nil");
+        break;
+    case node_type::boolean:
+        out_.write(static_cast<const node_boolean&>(n).value ? "true" : "false");
+        break;
+    case node_type::identifier:
+        out_.write(static_cast<const node_identifier&>(n).value);
+        break;
+    case node_type::string:
+        out_.write(static_cast<const node_string&>(n).value);
+        break;
+    case node_type::number:
+        out_.write(static_cast<const node_number&>(n).value);
+        break;
+    case node_type::length:
+        out_.write('#');
+        this->print_operand(static_cast<const node_length&>(n).obj, n);
+        break;
+    case node_type::field:
+    {
+        const auto& field = static_cast<const node_field&>(n);
+        this->print_prefix(field.obj);
+        out_.write('.');
+        this->print(*field.field.as_node);
+        break;
+    }
+    case node_type::method:
+    {
+        const auto& method = static_cast<const node_method&>(n);
+        this->print_prefix(method.obj);
+        out_.write(':');
+        this->print(*method.field.as_node);
+        break;
+    }
+    case node_type::index:
+    {
+        const auto& index = static_cast<const node_index&>(n);
+        this->print_prefix(index.obj);
+        out_.write('[');
+        this->print(*index.key.as_node);
+        out_.write(']');
+        break;
+    }
+    case node_type::upvalue:
+        out_.write(static_cast<const node_upvalue&>(n).name);
+        break;
+    case node_type::vararg:
+        out_.write("...");
+        break;
+    case node_type::newtable:
+        this->print_table(static_cast<const node_newtable&>(n));
+        break;
+    case node_type::entry:
+    {
+        const auto& entry = static_cast<const node_entry&>(n);
+
+        if (!entry.name) out_.write('[');
+        this->print(*entry.key.as_node);
+        out_.write(entry.name ? " = " : "] = ");
+        this->print(*entry.value.as_node);
+        break;
+    }
+    case node_type::concat:
+    {
+        const auto& list = static_cast<const node_concat&>(n).list;
+
+        for (const auto& entry : list)
+        {
+            if (&entry != &list.front()) out_.write(" .. ");
+            this->print_operand(entry, n);
+        }
+        break;
+    }
+    case node_type::call:
+    {
+        const auto& call = static_cast<const node_call&>(n);
+        this->print_prefix(call.name);
+        out_.write('(');
+        this->print(*call.params.as_node);
+        out_.write(')');
+        break;
+    }
+    case node_type::assign:
+    {
+        const auto& assign = static_cast<const node_assign&>(n);
+        this->print_binary(assign.lvalue, " = ", assign.rvalue);
+        break;
+    }
+    case node_type::equal:
+    {
+        const auto& equal = static_cast<const node_equal&>(n);
+        this->print_operator(equal.lvalue, " == ", equal.rvalue, n);
+        break;
+    }
+    case node_type::not_equal:
+    {
+        const auto& not_equal = static_cast<const node_not_equal&>(n);
+        this->print_operator(not_equal.lvalue, " ~= ", not_equal.rvalue, n);
+        break;
+    }
+    case node_type::less:
+    {
+        const auto& less = static_cast<const node_less&>(n);
+        this->print_operator(less.lvalue, " < ", less.rvalue, n);
+        break;
+    }
+    case node_type::less_equal:
+    {
+        const auto& less_equal = static_cast<const node_less_equal&>(n);
+        this->print_operator(less_equal.lvalue, " <= ", less_equal.rvalue, n);
+        break;
+    }
+    case node_type::op_and:
+    {
+        const auto& op_and = static_cast<const node_and&>(n);
+        this->print_operator(op_and.lvalue, " and ", op_and.rvalue, n);
+        break;
+    }
+    case node_type::op_or:
+    {
+        const auto& op_or = static_cast<const node_or&>(n);
+        this->print_operator(op_or.lvalue, " or ", op_or.rvalue, n);
+        break;
+    }
+    case node_type::binary:
+    {
+        const auto& binary = static_cast<const node_binary&>(n);
+        this->print_operator(binary.lvalue, binary_text(binary.op), binary.rvalue, n);
+        break;
+    }
+    case node_type::unary:
+        out_.write('-');
+        this->print_operand(static_cast<const node_unary&>(n).obj, n);
+        break;
+    case node_type::op_not:
+        out_.write("not ");
+        this->print_operand(static_cast<const node_not&>(n).obj, n);
+        break;
+    case node_type::stmt_return:
+        this->print_return(static_cast<const node_return&>(n));
+        break;
+    case node_type::stmt_if:
+        this->print_if(static_cast<const node_if&>(n));
+        break;
+    case node_type::stmt_while:
+    {
+        const auto& loop = static_cast<const node_while&>(n);
+        out_.write("while ");
+        this->print(*loop.cond.as_node);
+        out_.write(" do");
+        this->print_body(loop.block);
+        out_.write("end");
+        break;
+    }
+    case node_type::stmt_repeat:
+    {
+        const auto& loop = static_cast<const node_repeat&>(n);
+        out_.write("repeat");
+        this->print_body(loop.block);
+        out_.write("until ");
+        this->print(*loop.cond.as_node);
+        break;
+    }
+    case node_type::stmt_for:
+        this->print_for(static_cast<const node_for&>(n));
+        break;
+    case node_type::stmt_for_in:
+    {
+        const auto& loop = static_cast<const node_for_in&>(n);
+        out_.write("for ");
+        this->print(*loop.vars.as_node);
+        out_.write(" in ");
+        this->print(*loop.list.as_node);
+        out_.write(" do");
+        this->print_body(loop.block);
+        out_.write("end");
+        break;
+    }
+    case node_type::stmt_break:
+        out_.write("break");
+        break;
+    case node_type::block:
+        this->print_block(static_cast<const node_block&>(n));
+        break;
+    case node_type::parameters:
+    {
+        const auto& params = static_cast<const node_parameters&>(n);
+
+        if (params.vararg) out_.write(" ... ");
+        else this->print_list(params.list, ", ");
+        break;
+    }
+    case node_type::function:
+        this->print_function(static_cast<const node_function&>(n));
+        break;
+    case node_type::script:
+        this->print(*static_cast<const node_script&>(n).main.as_node);
+        out_.write('\n');
+        break;
+    case node_type::test:
+        this->print_test(static_cast<const node_test&>(n));
+        break;
+    case node_type::jump:
+        out_.write("jump(");
+        this->print(*static_cast<const node_jump&>(n).loc.as_node);
+        out_.write(')');
+        break;
+    case node_type::label:
+        out_.write("-- ");
+        out_.write(static_cast<const node_label&>(n).loc);
+        out_.write(':');
+        break;
+    case node_type::debug:
+        out_.write("-- ");
+        out_.write(static_cast<const node_debug&>(n).data);
+        break;
+    default:
+        break;
+    }
+}
+
+void printer::print_list(const std::vector<child>& list, std::string_view separator)
+{
+    for (const auto& entry : list)
+    {
+        if (&entry != &list.front()) out_.write(separator);
+        this->print(*entry.as_node);
+    }
+}
+
+// a constructor holding another non empty one is laid out an entry per line
+void printer::print_table(const node_newtable& table)
+{
+    auto nested = std::any_of(table.list.begin(), table.list.end(), [](const child& entry)
+    {
+        const auto& value = (entry.type() == node_type::entry) ? entry.as_entry->value : entry;
+        return value.type() == node_type::newtable && !value.as_newtable->list.empty();
+    });
+
+    if (!nested)
+    {
+        out_.write('{');
+        this->print_list(table.list, ", ");
+        out_.write('}');
+        return;
+    }
+
+    out_.write('{');
+    depth_++;
+
+    for (const auto& entry : table.list)
+    {
+        out_.write('\n');
+        this->print_indent();
+        this->print(*entry.as_node);
+        if (&entry != &table.list.back()) out_.write(',');
+    }
+
+    depth_--;
+    out_.write('\n');
+    this->print_indent();
+    out_.write('}');
+}
+
+void printer::print_block(const node_block& block)
+{
+    for (const auto& stmt : block.stmts)
+    {
+        out_.write('\n');
+        this->print_indent();
+        this->print(*stmt.as_node);
+    }
+}
+
+void printer::print_function(const node_function& func)
+{
+    // the main chunk has no header, its body and closures sit at the current depth
+    if (func.name.type() == node_type::identifier && func.name.as_identifier->value == "_init_")
+    {
+        this->print(*func.block.as_node);
+
+        for (const auto& sub : func.sub_funcs)
+        {
+            out_.write('\n');
+            this->print(*sub.as_node);
+        }
+
+        return;
+    }
+
+    out_.write('\n');
+    this->print_indent();
+    out_.write("local function ");
+    this->print(*func.name.as_node);
+    out_.write('(');
+    this->print(*func.params.as_node);
+    out_.write(')');
+
+    depth_++;
+    this->print(*func.block.as_node);
+
+    for (const auto& sub : func.sub_funcs)
+    {
+        out_.write('\n');
+        this->print(*sub.as_node);
+    }
+
+    depth_--;
+
+    out_.write('\n');
+    this->print_indent();
+    out_.write("end");
+}
+
+// nested block one level deeper, leaves the cursor on a fresh line at the
+// current depth for the closing keyword
+void printer::print_body(const child& block)
+{
+    depth_++;
+    this->print(*block.as_node);
+    depth_--;
+
+    out_.write('\n');
+    this->print_indent();
+}
+
+void printer::print_if(const node_if& stmt)
+{
+    out_.write("if ");
+    this->print(*stmt.cond.as_node);
+    out_.write(" then");
+    this->print_body(stmt.then_block);
+
+    if (!stmt.else_block)
+    {
+        out_.write("end");
+        return;
+    }
+
+    const auto& stmts = stmt.else_block.as_block->stmts;
+
+    // an else holding a single if is printed as elseif
+    if (stmts.size() == 1 && stmts.front().type() == node_type::stmt_if)
+    {
+        out_.write("else");
+        this->print_if(*stmts.front().as_if);
+        return;
+    }
+
+    out_.write("else");
+    this->print_body(stmt.else_block);
+    out_.write("end");
+}
+
+void printer::print_for(const node_for& stmt)
+{
+    out_.write("for ");
+    this->print(*stmt.var.as_node);
+    out_.write(" = ");
+    this->print(*stmt.init.as_node);
+    out_.write(", ");
+    this->print(*stmt.limit.as_node);
+
+    if (stmt.step)
+    {
+        out_.write(", ");
+        this->print(*stmt.step.as_node);
+    }
+
+    out_.write(" do");
+    this->print_body(stmt.block);
+    out_.write("end");
+}
+
+void printer::print_return(const node_return& ret)
+{
+    out_.write("return");
+
+    for (const auto& stmt : ret.stmts)
+    {
+        out_.write(' ');
+        this->print(*stmt.as_node);
+        if (&stmt != &ret.stmts.back()) out_.write(',');
+    }
+}
+
+void printer::print_test(const node_test& test)
+{
+    out_.write(test.is_not ? "if not " : "if ");
+    this->print(*test.cond.as_node);
+    out_.write(" then");
+}
+
+void printer::print_binary(const child& lvalue, std::string_view op, const child& rvalue)
+{
+    this->print(*lvalue.as_node);
+    out_.write(op);
+    this->print(*rvalue.as_node);
+}
+
+void printer::print_operator(const child& lvalue, std::string_view op, const child& rvalue, const node& parent)
+{
+    this->print_operand(lvalue, parent, true);
+    out_.write(op);
+    this->print_operand(rvalue, parent);
+}
+
+// parenthesizes operands that bind looser than the operator they sit under.
+// at the same level only the left operand of the left associative arithmetic
+// operators, and any operand of and / or, can go without
+void printer::print_operand(const child& operand, const node& parent, bool left)
+{
+    auto inner = precedence(*operand.as_node);
+    auto outer = precedence(parent);
+    auto free = parent.type == node_type::op_and || parent.type == node_type::op_or ||
+        (left && (outer == 5 || outer == 6));
+    auto wrap = inner < outer || (inner == outer && !free);
+
+    if (wrap) out_.write('(');
+    this->print(*operand.as_node);
+    if (wrap) out_.write(')');
+}
+
+// object of a call, field or index, anything but a name or another access
+// needs parentheses there
+void printer::print_prefix(const child& obj)
+{
+    switch (obj.type())
+    {
+    case node_type::identifier:
+    case node_type::field:
+    case node_type::method:
+    case node_type::index:
+    case node_type::upvalue:
+    case node_type::call:
+        this->print(*obj.as_node);
+        break;
+    default:
+        out_.write('(');
+        this->print(*obj.as_node);
+        out_.write(')');
+        break;
+    }
+}
+
+auto printer::precedence(const node& n) -> std::uint32_t
+{
+    switch (n.type)
+    {
+    case node_type::op_or: return 1;
+    case node_type::op_and: return 2;
+    case node_type::equal:
+    case node_type::not_equal:
+    case node_type::less:
+    case node_type::less_equal: return 3;
+    case node_type::concat: return 4;
+    case node_type::binary:
+        switch (static_cast<const node_binary&>(n).op)
+        {
+        case binary_op::add:
+        case binary_op::sub: return 5;
+        case binary_op::pow: return 8;
+        default: return 6;
+        }
+    case node_type::op_not:
+    case node_type::length:
+    case node_type::unary: return 7;
+    // a negative literal reads as a negation
+    case node_type::number: return (static_cast<const node_number&>(n).value[0] == '-') ? 7 : 9;
+    default: return 9;
+    }
+}
+
+auto printer::binary_text(binary_op op) -> std::string_view
+{
+    switch (op)
+    {
+    case binary_op::add: return " + ";
+    case binary_op::sub: return " - ";
+    case binary_op::mul: return " * ";
+    case binary_op::div: return " / ";
+    case binary_op::mod: return " % ";
+    default: return " ^ ";
+    }
+}
+
+void printer::print_indent()
+{
+    out_.write_spaces(depth_ * indent_width_);
+}
+
+} // namespace lui
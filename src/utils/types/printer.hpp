@@ -0,0 +1,48 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_PRINTER_HPP_
+#define _LUI_PRINTER_HPP_
+
+namespace lui
+{
+
+// walks a node tree once and writes lua source straight into the sink,
+// dispatching on the node type tag. nothing is built up per node, so the
+// output is linear in the size of the tree.
+class printer
+{
+    utils::text_writer& out_;
+    std::uint32_t indent_width_;
+    std::uint32_t depth_;
+
+public:
+    printer(utils::text_writer& out, std::uint32_t indent_width = 4);
+
+    void print(const node_script& script);
+    void print(const node& n);
+
+private:
+    void print_list(const std::vector<child>& list, std::string_view separator);
+    void print_table(const node_newtable& table);
+    void print_block(const node_block& block);
+    void print_function(const node_function& func);
+    void print_body(const child& block);
+    void print_if(const node_if& stmt);
+    void print_for(const node_for& stmt);
+    void print_return(const node_return& ret);
+    void print_test(const node_test& test);
+    void print_binary(const child& lvalue, std::string_view op, const child& rvalue);
+    void print_operator(const child& lvalue, std::string_view op, const child& rvalue, const node& parent);
+    void print_operand(const child& operand, const node& parent, bool left = false);
+    void print_prefix(const child& obj);
+    void print_indent();
+    static auto precedence(const node& n) -> std::uint32_t;
+    static auto binary_text(binary_op op) -> std::string_view;
+};
+
+} // namespace lui
+
+#endif // _LUI_PRINTER_HPP_
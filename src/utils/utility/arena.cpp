@@ -0,0 +1,63 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+arena::arena() : block_(0), used_(0) {}
+
+arena::~arena()
+{
+    this->clear();
+}
+
+void arena::clear()
+{
+    for (auto itr = cleanups_.rbegin(); itr != cleanups_.rend(); itr++)
+    {
+        itr->destroy(itr->ptr);
+    }
+
+    cleanups_.clear();
+    large_.clear();
+    block_ = 0;
+    used_ = 0;
+}
+
+auto arena::capacity() -> std::size_t
+{
+    return blocks_.size() * block_size;
+}
+
+auto arena::allocate(std::size_t size, std::size_t align) -> void*
+{
+    if (size > block_size / 4)
+    {
+        large_.push_back(std::unique_ptr<std::uint8_t[]>(new std::uint8_t[size]));
+        return large_.back().get();
+    }
+
+    auto offset = (used_ + align - 1) & ~(align - 1);
+
+    if (blocks_.empty() || offset + size > block_size)
+    {
+        // move on to the next block, reusing the ones kept by clear()
+        if (!blocks_.empty()) block_++;
+
+        if (block_ == blocks_.size())
+        {
+            blocks_.push_back(std::unique_ptr<std::uint8_t[]>(new std::uint8_t[block_size]));
+        }
+
+        offset = 0;
+    }
+
+    used_ = offset + size;
+    return blocks_[block_].get() + offset;
+}
+
+} // namespace utils
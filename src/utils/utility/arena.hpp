@@ -0,0 +1,59 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_ARENA_HPP_
+#define _LUI_UTILS_ARENA_HPP_
+
+namespace utils
+{
+
+// bump allocator for many small objects that die together. clear() runs the
+// destructors in reverse order and keeps the blocks for the next round.
+class arena
+{
+    static constexpr std::size_t block_size = 0x10000;
+
+    struct cleanup
+    {
+        void* ptr;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<std::uint8_t[]>> blocks_;
+    std::vector<std::unique_ptr<std::uint8_t[]>> large_;
+    std::vector<cleanup> cleanups_;
+    std::size_t block_;
+    std::size_t used_;
+
+public:
+    arena();
+    ~arena();
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    template <typename T, typename ... Args>
+    auto make(Args&& ... args) -> T*
+    {
+        auto obj = new(this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            cleanups_.push_back({ obj, [](void* ptr) { static_cast<T*>(ptr)->~T(); } });
+        }
+
+        return obj;
+    }
+
+    void clear();
+    auto capacity() -> std::size_t;
+
+private:
+    auto allocate(std::size_t size, std::size_t align) -> void*;
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_ARENA_HPP_
@@ -0,0 +1,153 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_BOUNDED_QUEUE_HPP_
+#define _LUI_UTILS_BOUNDED_QUEUE_HPP_
+
+namespace utils
+{
+
+// fixed size lock-free queue for any number of producers and consumers. every
+// cell carries a sequence number telling whose turn it is, so a push or pop
+// is one compare-exchange on the shared position. push waits while the queue
+// is full, which holds a fast stage back to the pace of the one after it.
+template <typename T>
+class bounded_queue
+{
+    struct cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<cell[]> cells_;
+    std::size_t mask_;
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
+    alignas(64) std::atomic<bool> closed_;
+
+public:
+    // capacity is rounded up to a power of two
+    explicit bounded_queue(std::size_t capacity) : head_(0), tail_(0), closed_(false)
+    {
+        auto size = std::size_t(2);
+        while (size < capacity) size <<= 1;
+
+        cells_ = std::make_unique<cell[]>(size);
+        mask_ = size - 1;
+
+        for (auto i = 0u; i < size; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bounded_queue(const bounded_queue&) = delete;
+    bounded_queue& operator=(const bounded_queue&) = delete;
+
+    auto try_push(T& value) -> bool
+    {
+        auto pos = tail_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.sequence.load(std::memory_order_acquire);
+            auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    c.value = std::move(value);
+                    c.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    auto try_pop(T& value) -> bool
+    {
+        auto pos = head_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            auto& c = cells_[pos & mask_];
+            auto seq = c.sequence.load(std::memory_order_acquire);
+            auto diff = std::intptr_t(seq) - std::intptr_t(pos + 1);
+
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(c.value);
+                    c.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T value)
+    {
+        for (auto spins = 0u; !this->try_push(value); spins++)
+        {
+            backoff(spins);
+        }
+    }
+
+    // waits for a value, false once the queue is closed and drained
+    auto pop(T& value) -> bool
+    {
+        for (auto spins = 0u; !this->try_pop(value); spins++)
+        {
+            if (closed_.load(std::memory_order_acquire))
+            {
+                // a push may have landed between the failed pop and the close
+                return this->try_pop(value);
+            }
+
+            backoff(spins);
+        }
+
+        return true;
+    }
+
+    // no more pushes, consumers drain what is left and stop
+    void close()
+    {
+        closed_.store(true, std::memory_order_release);
+    }
+
+private:
+    static void backoff(std::uint32_t spins)
+    {
+        if (spins < 64) return;
+
+        if (spins < 256) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_BOUNDED_QUEUE_HPP_
@@ -10,24 +10,22 @@ namespace utils
 
 byte_buffer::byte_buffer()
 {
-    data_.resize(0x1000000);
-    std::fill(data_.begin(), data_.end(), 0);
-    size_ = data_.size();
+    size_ = 0;
     pos_ = 0;
 }
 
+// size is only a capacity hint, the buffer starts empty and grows on write
 byte_buffer::byte_buffer(std::size_t size)
 {
-    data_.resize(size);
-    std::fill(data_.begin(), data_.end(), 0);
-    size_ = size;
+    data_.reserve(size);
+    size_ = 0;
     pos_ = 0;
 }
 
 byte_buffer::byte_buffer(std::vector<std::uint8_t> data)
 {
-    data_ = data;
-    size_ = data.size();
+    data_ = std::move(data);
+    size_ = data_.size();
     pos_ = 0;
 }
 
@@ -60,12 +58,45 @@ byte_buffer::~byte_buffer()
 
 void byte_buffer::clear()
 {
-    std::fill(data_.begin(), data_.end(), 0);
+    data_.clear();
+    size_ = 0;
+    pos_ = 0;
+}
+
+void byte_buffer::reserve(std::size_t size)
+{
+    data_.reserve(size);
+}
+
+auto byte_buffer::release() -> std::vector<std::uint8_t>
+{
+    auto data = std::move(data_);
+
+    data_.clear();
+    size_ = 0;
+    pos_ = 0;
+
+    return data;
+}
+
+void byte_buffer::grow(std::size_t count)
+{
+    auto end = pos_ + count;
+
+    if (end <= data_.size()) return;
+
+    if (end > data_.capacity())
+    {
+        data_.reserve(std::max<std::size_t>({ end, data_.capacity() * 2, 0x100 }));
+    }
+
+    data_.resize(end);
+    size_ = end;
 }
 
 auto byte_buffer::is_avail() -> bool
 {
-    if (pos_ < data_.size()) return true;
+    if (pos_ < size_) return true;
     return false;
 }
 
@@ -78,23 +109,31 @@ void byte_buffer::seek_neg(std::size_t pos)
     pos_ -= pos;
 }
 
-void byte_buffer::write_string(const std::string& data)
+void byte_buffer::write_string(std::string_view data)
 {
-    std::strcpy(reinterpret_cast<char*>(data_.data() + pos_), data.data());
+    this->grow(data.size());
+    std::memcpy(data_.data() + pos_, data.data(), data.size());
     pos_ += data.size();
 }
 
-void byte_buffer::write_c_string(const std::string& data)
+void byte_buffer::write_c_string(std::string_view data)
 {
-    std::strcpy(reinterpret_cast<char*>(data_.data() + pos_), data.data());
+    this->grow(data.size() + 1);
+    std::memcpy(data_.data() + pos_, data.data(), data.size());
+    data_[pos_ + data.size()] = 0;
     pos_ += data.size() + 1;
 }
 
 auto byte_buffer::read_string() -> std::string
 {
-    if(pos_ >= size_) { LOG_ERROR("buffer read overflow %lX", pos_); }
+    if(pos_ >= size_) { LOG_ERROR("buffer read overflow %zX", pos_); }
+
+    auto begin = reinterpret_cast<const char*>(data_.data() + pos_);
+    auto end = reinterpret_cast<const char*>(std::memchr(begin, 0, size_ - pos_));
+
+    if(end == nullptr) { LOG_ERROR("unterminated string at %zX", pos_); }
 
-    auto ret = std::string(reinterpret_cast<const char*>(data_.data() + pos_));
+    auto ret = std::string(begin, end);
     pos_ += ret.size() + 1;
     return ret;
 }
@@ -25,18 +25,22 @@ public:
     template <typename T>
     auto read() -> T
     {
-        if(pos_ >= size_) { LOG_ERROR("buffer read overflow %lX", pos_); }
+        if(pos_ > size_ || sizeof(T) > size_ - pos_) { LOG_ERROR("buffer read overflow %zX", pos_); }
 
-        auto ret = *reinterpret_cast<T*>(data_.data() + pos_);
+        T ret;
+        std::memcpy(&ret, data_.data() + pos_, sizeof(T));
         pos_ += sizeof(T);
         return ret;
     }
 
+    // the returned pointer is only valid until the next write
     template <typename T>
     auto write(T data) -> T*
     {
+        this->grow(sizeof(T));
+
         T* mem = reinterpret_cast<T*>(data_.data() + pos_);
-        memcpy(mem, &data, sizeof(T));
+        std::memcpy(mem, &data, sizeof(T));
 
         pos_ += sizeof(T);
 
@@ -44,16 +48,21 @@ public:
     }
 
     void clear();
+    void reserve(std::size_t size);
+    auto release() -> std::vector<std::uint8_t>;
     auto is_avail() -> bool;
     void seek(std::size_t pos);
     void seek_neg(std::size_t pos);
-    void write_string(const std::string& data);
-    void write_c_string(const std::string& data);
+    void write_string(std::string_view data);
+    void write_c_string(std::string_view data);
     auto read_string() -> std::string;
     auto read_opaque_string() -> std::string;
     auto print_bytes(std::size_t pos, std::size_t count) -> std::string;
     auto pos() -> std::size_t;
     auto buffer() -> std::vector<std::uint8_t>&;
+
+private:
+    void grow(std::size_t count);
 };
 
 using byte_buffer_ptr = std::unique_ptr<utils::byte_buffer>;
@@ -0,0 +1,90 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+byte_view::byte_view(const std::uint8_t* data, std::size_t size) : data_(data), size_(size), pos_(0) {}
+
+byte_view::byte_view(const std::vector<std::uint8_t>& data) : data_(data.data()), size_(data.size()), pos_(0) {}
+
+auto byte_view::is_avail() -> bool
+{
+    return pos_ < size_;
+}
+
+void byte_view::seek(std::size_t pos)
+{
+    if (this->require(pos)) pos_ += pos;
+}
+
+auto byte_view::require(std::size_t count) -> bool
+{
+    if (count <= size_ - pos_) return true;
+
+    this->fail(utils::string::va("read of %zu bytes past the end at 0x%zX", count, pos_));
+    return false;
+}
+
+void byte_view::fail(std::string error)
+{
+    if (error_.empty()) error_ = std::move(error);
+}
+
+auto byte_view::failed() const -> bool
+{
+    return !error_.empty();
+}
+
+auto byte_view::error() const -> const std::string&
+{
+    return error_;
+}
+
+auto byte_view::read_string() -> std::string
+{
+    return std::string(this->read_string_view());
+}
+
+// view of a nul terminated string, valid as long as the underlying memory
+auto byte_view::read_string_view() -> std::string_view
+{
+    auto begin = reinterpret_cast<const char*>(data_ + pos_);
+    auto end = (pos_ < size_) ? reinterpret_cast<const char*>(std::memchr(begin, 0, size_ - pos_)) : nullptr;
+
+    if (end == nullptr)
+    {
+        this->fail(utils::string::va("unterminated string at 0x%zX", pos_));
+        return {};
+    }
+
+    auto ret = std::string_view(begin, end - begin);
+    pos_ += ret.size() + 1;
+    return ret;
+}
+
+auto byte_view::pos() -> std::size_t
+{
+    return pos_;
+}
+
+auto byte_view::size() -> std::size_t
+{
+    return size_;
+}
+
+auto byte_view::remaining() const -> std::size_t
+{
+    return size_ - pos_;
+}
+
+auto byte_view::data() -> const std::uint8_t*
+{
+    return data_;
+}
+
+} // namespace utils
@@ -0,0 +1,85 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_BYTE_VIEW_HPP_
+#define _LUI_UTILS_BYTE_VIEW_HPP_
+
+namespace utils
+{
+
+// non-owning read cursor over memory that outlives it (a vector, a mapped file).
+// reads are checked: one past the end reads zeros, leaves the cursor where it
+// was and marks the view failed, so a parser over untrusted data runs to the
+// end of its current step and looks at failed() instead of dying mid file.
+// a parser that needs several fixed size fields checks them once with
+// require() and reads them with read_unchecked().
+class byte_view
+{
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_;
+    std::string error_;
+
+public:
+    byte_view(const std::uint8_t* data, std::size_t size);
+    byte_view(const std::vector<std::uint8_t>& data);
+
+    template <typename T>
+    auto read() -> T
+    {
+        if (!this->require(sizeof(T))) return T{};
+
+        return this->read_unchecked<T>();
+    }
+
+    // only after require() covered it
+    template <typename T>
+    auto read_unchecked() -> T
+    {
+        T ret;
+        std::memcpy(&ret, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return ret;
+    }
+
+    // one bounds check and copy for a whole array
+    template <typename T>
+    void read_array(std::vector<T>& out, std::size_t count)
+    {
+        if (count > this->remaining() / sizeof(T))
+        {
+            this->fail(utils::string::va("array of %zu read past the end at 0x%zX", count, pos_));
+            out.clear();
+            return;
+        }
+
+        out.resize(count);
+        std::memcpy(out.data(), data_ + pos_, count * sizeof(T));
+        pos_ += count * sizeof(T);
+    }
+
+    // whether count more bytes are there, fails the view when not
+    auto require(std::size_t count) -> bool;
+
+    // marks the view failed, the first error is the one kept
+    void fail(std::string error);
+    auto failed() const -> bool;
+    auto error() const -> const std::string&;
+
+    auto is_avail() -> bool;
+    void seek(std::size_t pos);
+    auto read_string() -> std::string;
+    auto read_string_view() -> std::string_view;
+    auto pos() -> std::size_t;
+    auto size() -> std::size_t;
+    auto remaining() const -> std::size_t;
+    auto data() -> const std::uint8_t*;
+};
+
+using byte_view_ptr = std::unique_ptr<utils::byte_view>;
+
+} // namespace utils
+
+#endif // _LUI_UTILS_BYTE_VIEW_HPP_
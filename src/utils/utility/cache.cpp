@@ -0,0 +1,186 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+cache::cache(const std::filesystem::path& dir, std::uintmax_t limit, std::string_view version)
+    : dir_(dir), limit_(limit), seed_(hash::xxh64(version.data(), version.size())), size_(0), temp_(0), stats_{}
+{
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::directory_entry>> found;
+
+    for (const auto& file : std::filesystem::directory_iterator(dir_, ec))
+    {
+        if (!file.is_regular_file(ec)) continue;
+
+        // left behind by a run that stopped while writing
+        if (file.path().extension() == ".tmp")
+        {
+            std::filesystem::remove(file.path(), ec);
+            continue;
+        }
+
+        found.push_back({ file.last_write_time(ec), file });
+    }
+
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (const auto& [time, file] : found)
+    {
+        this->insert(file.path().filename().string(), file.file_size(ec));
+    }
+
+    this->evict();
+}
+
+auto cache::key(const std::uint8_t* data, std::size_t size) const -> std::uint64_t
+{
+    return hash::xxh64(data, size, seed_);
+}
+
+auto cache::load(std::uint64_t key, std::string_view kind, std::vector<std::uint8_t>& data, bool count) -> bool
+{
+    auto name = hash::to_hex(key).append(kind);
+    auto path = dir_ / name;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = entries_.find(name);
+
+        if (it == entries_.end())
+        {
+            if (count) stats_.misses++;
+            return false;
+        }
+
+        order_.splice(order_.end(), order_, it->second.order);
+    }
+
+    std::ifstream stream(path, std::ios::binary);
+    std::error_code ec;
+
+    if (stream.good())
+    {
+        stream.seekg(0, std::ios::end);
+        data.resize(static_cast<std::size_t>(stream.tellg()));
+        stream.seekg(0, std::ios::beg);
+        stream.read(reinterpret_cast<char*>(data.data()), data.size());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // removed by someone else since the index was built
+    if (!stream.good())
+    {
+        this->erase(name);
+        if (count) stats_.misses++;
+        return false;
+    }
+
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+    if (count) stats_.hits++;
+
+    return true;
+}
+
+// written under a unique temporary name and renamed into place, so readers,
+// other threads storing the same key, and other processes never see a
+// partial entry
+void cache::store(std::uint64_t key, std::string_view kind, const std::vector<std::uint8_t>& data)
+{
+    auto name = hash::to_hex(key).append(kind);
+    auto temp = dir_ / utils::string::va("%s.%zu.tmp", name.data(), temp_++);
+    std::error_code ec;
+
+    {
+        std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+        stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+        if (!stream.good())
+        {
+            stream.close();
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temp, dir_ / name, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    this->erase(name);
+    this->insert(name, data.size());
+    this->evict();
+    stats_.stores++;
+}
+
+auto cache::statistics() -> stats
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto result = stats_;
+    result.entries = entries_.size();
+    result.size = size_;
+
+    return result;
+}
+
+void cache::print_stats()
+{
+    auto info = this->statistics();
+    auto total = info.hits + info.misses;
+
+    printf("cache: %zu hits, %zu misses (%.1f%% hit rate), %zu stored, %zu evicted, %zu entries, %.2f MB\n",
+        info.hits, info.misses, (total > 0) ? 100.0 * info.hits / total : 0.0, info.stores, info.evictions,
+        info.entries, info.size / (1024.0 * 1024.0));
+}
+
+// most recently used at the back of the order
+void cache::insert(const std::string& name, std::uintmax_t size)
+{
+    auto order = order_.insert(order_.end(), name);
+
+    entries_[name] = { size, order };
+    size_ += size;
+}
+
+void cache::erase(const std::string& name)
+{
+    auto it = entries_.find(name);
+
+    if (it == entries_.end()) return;
+
+    size_ -= it->second.size;
+    order_.erase(it->second.order);
+    entries_.erase(it);
+}
+
+void cache::evict()
+{
+    std::error_code ec;
+
+    while (size_ > limit_ && !order_.empty())
+    {
+        auto name = order_.front();
+
+        std::filesystem::remove(dir_ / name, ec);
+        this->erase(name);
+        stats_.evictions++;
+    }
+}
+
+} // namespace utils
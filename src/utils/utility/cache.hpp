@@ -0,0 +1,64 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_CACHE_HPP_
+#define _LUI_UTILS_CACHE_HPP_
+
+namespace utils
+{
+
+// on-disk store of tool outputs keyed by the hash of their input and the tool
+// version, one file per key and kind. the least recently used entries are
+// removed once the directory grows past its limit, a file's modification
+// time carries its recency over to the next run. safe to share between threads.
+class cache
+{
+public:
+    struct stats
+    {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t stores;
+        std::size_t evictions;
+        std::size_t entries;
+        std::uintmax_t size;
+    };
+
+private:
+    struct entry
+    {
+        std::uintmax_t size;
+        std::list<std::string>::iterator order;
+    };
+
+    std::filesystem::path dir_;
+    std::uintmax_t limit_;
+    std::uint64_t seed_;
+    std::mutex mutex_;
+    std::list<std::string> order_;
+    std::unordered_map<std::string, entry> entries_;
+    std::uintmax_t size_;
+    std::atomic<std::size_t> temp_;
+    stats stats_;
+
+public:
+    cache(const std::filesystem::path& dir, std::uintmax_t limit, std::string_view version);
+
+    auto key(const std::uint8_t* data, std::size_t size) const -> std::uint64_t;
+    // count is false for an intermediate looked up after its output missed
+    auto load(std::uint64_t key, std::string_view kind, std::vector<std::uint8_t>& data, bool count = true) -> bool;
+    void store(std::uint64_t key, std::string_view kind, const std::vector<std::uint8_t>& data);
+    auto statistics() -> stats;
+    void print_stats();
+
+private:
+    void insert(const std::string& name, std::uintmax_t size);
+    void erase(const std::string& name);
+    void evict();
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_CACHE_HPP_
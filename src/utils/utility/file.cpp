@@ -5,6 +5,13 @@
 
 #include "utils.hpp"
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
 namespace utils
 {
 
@@ -12,15 +19,7 @@ auto file::read(const std::string& file) -> std::vector<std::uint8_t>
 {
     std::vector<std::uint8_t> data;
 
-    FILE* fp = fopen(file.data(), "rb");
-    if (fp)
-    {
-        long len = utils::file::length(fp);
-        data.resize(len);
-        fread(data.data(), len, 1, fp);
-        fclose(fp);
-    }
-    else
+    if (!file::read(file, data))
     {
         printf("Couldn't open file %s!\n", file.data());
         std::exit(-1);
@@ -29,6 +28,29 @@ auto file::read(const std::string& file) -> std::vector<std::uint8_t>
     return data;
 }
 
+auto file::read(const std::string& file, std::vector<std::uint8_t>& data) -> bool
+{
+    data.clear();
+
+    FILE* fp = fopen(file.data(), "rb");
+    if (!fp) return false;
+
+    long len = utils::file::length(fp);
+    auto ok = len >= 0;
+
+    if (ok && len > 0)
+    {
+        data.resize(len);
+        ok = fread(data.data(), len, 1, fp) == 1;
+    }
+
+    fclose(fp);
+
+    if (!ok) data.clear();
+
+    return ok;
+}
+
 auto file::read_text(const std::string& file) -> std::string
 {
     std::string data;
@@ -56,11 +78,35 @@ auto file::read_text(const std::string& file) -> std::string
 }
 
 
-void file::save(const std::string& file, const std::vector<std::uint8_t>& data)
+auto file::save(const std::string& file, const std::vector<std::uint8_t>& data) -> bool
 {
     FILE* fp = fopen(file.data(), "wb");
-    fwrite(data.data(), 1, data.size(), fp);
-    fclose(fp);
+    if (!fp) return false;
+
+    auto ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+
+    return (fclose(fp) == 0) && ok;
+}
+
+// path of the running program, empty when it can't be found
+auto file::executable() -> std::string
+{
+#if defined(_WIN32)
+    char path[MAX_PATH];
+    auto size = GetModuleFileNameA(nullptr, path, MAX_PATH);
+
+    return (size > 0 && size < MAX_PATH) ? std::string(path, size) : std::string();
+#elif defined(__APPLE__)
+    char path[4096];
+    std::uint32_t size = sizeof(path);
+
+    return (_NSGetExecutablePath(path, &size) == 0) ? std::string(path) : std::string();
+#else
+    std::error_code ec;
+    auto path = std::filesystem::read_symlink("/proc/self/exe", ec);
+
+    return ec ? std::string() : path.string();
+#endif
 }
 
 auto file::length(FILE* fp) -> long
@@ -13,9 +13,13 @@ class file
 {
 public:
     static auto read(const std::string& file) -> std::vector<std::uint8_t>;
+    // false when the file can't be read
+    static auto read(const std::string& file, std::vector<std::uint8_t>& data) -> bool;
     static auto read_text(const std::string& file) -> std::string;
-    static void save(const std::string& file, const std::vector<std::uint8_t>& data);
+    // false when the file can't be written
+    static auto save(const std::string& file, const std::vector<std::uint8_t>& data) -> bool;
     static auto length(FILE* fp) -> long;
+    static auto executable() -> std::string;
 };
 
 } // namespace utils
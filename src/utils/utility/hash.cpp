@@ -0,0 +1,121 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+namespace
+{
+
+constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr std::uint64_t prime3 = 0x165667B19E3779F9ull;
+constexpr std::uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+constexpr std::uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+inline auto rotl(std::uint64_t value, int count) -> std::uint64_t
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+inline auto read64(const std::uint8_t* p) -> std::uint64_t
+{
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline auto read32(const std::uint8_t* p) -> std::uint32_t
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline auto round(std::uint64_t acc, std::uint64_t input) -> std::uint64_t
+{
+    acc += input * prime2;
+    return rotl(acc, 31) * prime1;
+}
+
+inline auto merge(std::uint64_t acc, std::uint64_t value) -> std::uint64_t
+{
+    acc ^= round(0, value);
+    return acc * prime1 + prime4;
+}
+
+} // namespace
+
+// little endian reads, as on every target the tool builds for
+auto hash::xxh64(const void* data, std::size_t size, std::uint64_t seed) -> std::uint64_t
+{
+    auto p = static_cast<const std::uint8_t*>(data);
+    auto end = p + size;
+    std::uint64_t h;
+
+    if (size >= 32)
+    {
+        auto v1 = seed + prime1 + prime2;
+        auto v2 = seed + prime2;
+        auto v3 = seed;
+        auto v4 = seed - prime1;
+
+        for (auto limit = end - 32; p <= limit; p += 32)
+        {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    }
+    else
+    {
+        h = seed + prime5;
+    }
+
+    h += size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= read32(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+    {
+        h ^= *p * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+auto hash::to_hex(std::uint64_t value) -> std::string
+{
+    return utils::string::va("%016llX", static_cast<unsigned long long>(value));
+}
+
+} // namespace utils
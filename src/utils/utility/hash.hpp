@@ -0,0 +1,23 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_HASH_HPP_
+#define _LUI_UTILS_HASH_HPP_
+
+namespace utils
+{
+
+// xxHash64, a fast non-cryptographic hash used to key cached outputs by the
+// contents of their inputs.
+class hash
+{
+public:
+    static auto xxh64(const void* data, std::size_t size, std::uint64_t seed = 0) -> std::uint64_t;
+    static auto to_hex(std::uint64_t value) -> std::string;
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_HASH_HPP_
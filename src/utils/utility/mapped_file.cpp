@@ -0,0 +1,123 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& file) : data_(nullptr), size_(0), file_(nullptr), mapping_(nullptr)
+{
+    auto handle = CreateFileA(file.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        error_ = "couldn't open file";
+        return;
+    }
+
+    file_ = handle;
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(handle, &size))
+    {
+        error_ = "couldn't open file";
+        return;
+    }
+
+    size_ = static_cast<std::size_t>(size.QuadPart);
+
+    if (size_ == 0) return;
+
+    mapping_ = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping_ != nullptr)
+    {
+        data_ = reinterpret_cast<const std::uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+
+    if (data_ == nullptr)
+    {
+        size_ = 0;
+        error_ = "couldn't map file";
+    }
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_ != nullptr) UnmapViewOfFile(data_);
+    if (mapping_ != nullptr) CloseHandle(mapping_);
+    if (file_ != nullptr) CloseHandle(file_);
+}
+
+#else
+
+mapped_file::mapped_file(const std::string& file) : data_(nullptr), size_(0), fd_(-1)
+{
+    fd_ = open(file.data(), O_RDONLY);
+
+    struct stat info;
+
+    if (fd_ < 0 || fstat(fd_, &info) != 0)
+    {
+        error_ = "couldn't open file";
+        return;
+    }
+
+    size_ = static_cast<std::size_t>(info.st_size);
+
+    if (size_ == 0) return;
+
+    auto mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+
+    if (mem == MAP_FAILED)
+    {
+        size_ = 0;
+        error_ = "couldn't map file";
+        return;
+    }
+
+    data_ = reinterpret_cast<const std::uint8_t*>(mem);
+    madvise(mem, size_, MADV_SEQUENTIAL);
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_ != nullptr) munmap(const_cast<std::uint8_t*>(data_), size_);
+    if (fd_ >= 0) close(fd_);
+}
+
+#endif // _WIN32
+
+auto mapped_file::data() const -> const std::uint8_t*
+{
+    return data_;
+}
+
+auto mapped_file::size() const -> std::size_t
+{
+    return size_;
+}
+
+auto mapped_file::error() const -> const std::string&
+{
+    return error_;
+}
+
+} // namespace utils
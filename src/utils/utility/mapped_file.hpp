@@ -0,0 +1,42 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_MAPPED_FILE_HPP_
+#define _LUI_UTILS_MAPPED_FILE_HPP_
+
+namespace utils
+{
+
+// read-only memory mapping of a whole file, the contents stay valid until
+// the object is destroyed. a file that can't be opened or mapped is empty and
+// error() tells why.
+class mapped_file
+{
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::string error_;
+#ifdef _WIN32
+    void* file_;
+    void* mapping_;
+#else
+    int fd_;
+#endif
+
+public:
+    mapped_file(const std::string& file);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file();
+
+    auto data() const -> const std::uint8_t*;
+    auto size() const -> std::size_t;
+    auto error() const -> const std::string&;
+};
+
+using mapped_file_ptr = std::unique_ptr<utils::mapped_file>;
+
+} // namespace utils
+
+#endif // _LUI_UTILS_MAPPED_FILE_HPP_
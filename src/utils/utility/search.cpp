@@ -0,0 +1,81 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+namespace
+{
+
+// large enough that a slice costs far more than handing it to a worker
+constexpr std::size_t slice_size = 16 * 1024 * 1024;
+
+// matches starting in [begin, end), the pattern may run past end
+void find_range(const std::uint8_t* data, std::size_t size, std::size_t begin, std::size_t end,
+    std::string_view pattern, std::vector<std::size_t>& out)
+{
+    if (pattern.empty() || size < pattern.size()) return;
+
+    auto first = static_cast<std::uint8_t>(pattern[0]);
+    auto last = std::min(end, size - pattern.size() + 1);
+    auto pos = begin;
+
+    while (pos < last)
+    {
+        auto hit = static_cast<const std::uint8_t*>(std::memchr(data + pos, first, last - pos));
+
+        if (hit == nullptr) break;
+
+        pos = hit - data;
+
+        if (std::memcmp(hit + 1, pattern.data() + 1, pattern.size() - 1) == 0)
+        {
+            out.push_back(pos);
+        }
+
+        pos++;
+    }
+}
+
+} // namespace
+
+auto search::find_all(const std::uint8_t* data, std::size_t size, std::string_view pattern)
+    -> std::vector<std::size_t>
+{
+    std::vector<std::size_t> out;
+
+    find_range(data, size, 0, size, pattern, out);
+
+    return out;
+}
+
+auto search::find_all(thread_pool& pool, const std::uint8_t* data, std::size_t size, std::string_view pattern)
+    -> std::vector<std::size_t>
+{
+    auto count = (size + slice_size - 1) / slice_size;
+
+    if (count <= 1) return search::find_all(data, size, pattern);
+
+    std::vector<std::vector<std::size_t>> slices(count);
+
+    pool.run(count, [&](std::size_t, std::size_t index)
+    {
+        auto begin = index * slice_size;
+        find_range(data, size, begin, std::min(begin + slice_size, size), pattern, slices[index]);
+    });
+
+    std::vector<std::size_t> out;
+
+    for (const auto& slice : slices)
+    {
+        out.insert(out.end(), slice.begin(), slice.end());
+    }
+
+    return out;
+}
+
+} // namespace utils
@@ -0,0 +1,29 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_SEARCH_HPP_
+#define _LUI_UTILS_SEARCH_HPP_
+
+namespace utils
+{
+
+// byte pattern search over large buffers. candidates for the first byte are
+// found with memchr, which the c library vectorizes, and only those are
+// compared in full.
+class search
+{
+public:
+    // offsets of every match in order, overlapping ones included
+    static auto find_all(const std::uint8_t* data, std::size_t size, std::string_view pattern)
+        -> std::vector<std::size_t>;
+
+    // the same, with the buffer cut in slices searched on the pool
+    static auto find_all(thread_pool& pool, const std::uint8_t* data, std::size_t size, std::string_view pattern)
+        -> std::vector<std::size_t>;
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_SEARCH_HPP_
@@ -83,4 +83,69 @@ auto string::get_string_literal(std::string str) -> std::string
     return str.substr(1, str.size() - 2);
 }
 
+// wraps in double quotes, escapes quotes, backslashes and control chars as \ddd
+auto string::quote(std::string_view str) -> std::string
+{
+    utils::text_writer writer;
+    writer.write_quoted(str);
+
+    auto data = writer.release();
+    return std::string(data.begin(), data.end());
+}
+
+// reverses quote(), expects the text between the quotes
+auto string::unquote(std::string_view str) -> std::string
+{
+    std::string data;
+    data.reserve(str.size());
+
+    for (std::size_t i = 0; i < str.size(); i++)
+    {
+        if (str[i] != '\\' || i + 1 == str.size())
+        {
+            data += str[i];
+            continue;
+        }
+
+        auto c = str[++i];
+
+        switch (c)
+        {
+        case 'n': data += '\n'; break;
+        case 'r': data += '\r'; break;
+        case 't': data += '\t'; break;
+        default:
+            if (std::isdigit(static_cast<std::uint8_t>(c)))
+            {
+                auto value = 0;
+                for (auto n = 0; n < 3 && i < str.size() && std::isdigit(static_cast<std::uint8_t>(str[i])); n++, i++)
+                {
+                    value = value * 10 + (str[i] - '0');
+                }
+                i--;
+                data += static_cast<char>(value);
+            }
+            else
+            {
+                data += c;
+            }
+            break;
+        }
+    }
+
+    return data;
+}
+
+auto string::trim(std::string_view str) -> std::string_view
+{
+    while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) str.remove_prefix(1);
+    while (!str.empty() && (str.back() == ' ' || str.back() == '\t' || str.back() == '\r')) str.remove_suffix(1);
+    return str;
+}
+
+auto string::starts_with(std::string_view str, std::string_view prefix) -> bool
+{
+    return str.substr(0, prefix.size()) == prefix;
+}
+
 } // namespace utils
@@ -29,6 +29,10 @@ public:
     static auto split(std::string& str, char delimiter) -> std::vector<std::string>;
     static auto clean_buffer_lines(std::vector<std::uint8_t>& buffer) -> std::vector<std::string>;
     static auto get_string_literal(std::string str) -> std::string;
+    static auto quote(std::string_view str) -> std::string;
+    static auto unquote(std::string_view str) -> std::string;
+    static auto trim(std::string_view str) -> std::string_view;
+    static auto starts_with(std::string_view str, std::string_view prefix) -> bool;
 };
 
 } // namespace utils
@@ -0,0 +1,65 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+string_pool::string_pool() : used_(block_size) {}
+
+auto string_pool::intern(std::string_view str) -> std::string_view
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto itr = strings_.find(str);
+
+    if (itr != strings_.end()) return *itr;
+
+    auto data = this->allocate(str.size());
+    if (!str.empty()) std::memcpy(data, str.data(), str.size());
+
+    return *strings_.emplace(data, str.size()).first;
+}
+
+auto string_pool::store(std::string_view block) -> std::string_view
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto data = this->allocate(block.size());
+    std::memcpy(data, block.data(), block.size());
+
+    return std::string_view(data, block.size());
+}
+
+auto string_pool::size() -> std::size_t
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return strings_.size();
+}
+
+// blocks are zero filled, so every string is also nul terminated
+auto string_pool::allocate(std::size_t size) -> char*
+{
+    // long strings get a block of their own so the current one isn't wasted
+    if (size > block_size / 4)
+    {
+        large_.push_back(std::make_unique<char[]>(size + 1));
+        return large_.back().get();
+    }
+
+    if (used_ + size + 1 > block_size)
+    {
+        blocks_.push_back(std::make_unique<char[]>(block_size));
+        used_ = 0;
+    }
+
+    auto data = blocks_.back().get() + used_;
+    used_ += size + 1;
+    return data;
+}
+
+} // namespace utils
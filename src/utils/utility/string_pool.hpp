@@ -0,0 +1,42 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_STRING_POOL_HPP_
+#define _LUI_UTILS_STRING_POOL_HPP_
+
+namespace utils
+{
+
+// interned strings: equal strings share one copy, and the views handed out
+// stay valid for the lifetime of the pool. safe to share between threads.
+class string_pool
+{
+    static constexpr std::size_t block_size = 0x10000;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::vector<std::unique_ptr<char[]>> large_;
+    std::size_t used_;
+    std::unordered_set<std::string_view> strings_;
+
+public:
+    string_pool();
+
+    auto intern(std::string_view str) -> std::string_view;
+
+    // copies a block of strings that are already distinct in one go, views
+    // into the copy last as long as the pool but are not interned
+    auto store(std::string_view block) -> std::string_view;
+    auto size() -> std::size_t;
+
+private:
+    auto allocate(std::size_t size) -> char*;
+};
+
+using string_pool_ptr = std::shared_ptr<utils::string_pool>;
+
+} // namespace utils
+
+#endif // _LUI_UTILS_STRING_POOL_HPP_
@@ -0,0 +1,123 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+void text_writer::reserve(std::size_t size)
+{
+    data_.reserve(size);
+}
+
+void text_writer::clear()
+{
+    data_.clear();
+}
+
+auto text_writer::release() -> std::vector<std::uint8_t>
+{
+    auto data = std::move(data_);
+    data_.clear();
+    return data;
+}
+
+auto text_writer::size() -> std::size_t
+{
+    return data_.size();
+}
+
+void text_writer::write(char c)
+{
+    data_.push_back(static_cast<std::uint8_t>(c));
+}
+
+void text_writer::write(std::string_view text)
+{
+    data_.insert(data_.end(), text.begin(), text.end());
+}
+
+void text_writer::write_padded(std::string_view text, std::size_t width)
+{
+    this->write(text);
+
+    if (text.size() < width) this->write_spaces(width - text.size());
+}
+
+void text_writer::write_spaces(std::size_t count)
+{
+    data_.insert(data_.end(), count, ' ');
+}
+
+void text_writer::write_int(std::int64_t value)
+{
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    data_.insert(data_.end(), buf, res.ptr);
+}
+
+void text_writer::write_hex(std::uint64_t value, std::size_t digits)
+{
+    static constexpr char table[] = "0123456789ABCDEF";
+
+    char buf[16];
+    auto pos = sizeof(buf);
+
+    do
+    {
+        buf[--pos] = table[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+
+    auto count = sizeof(buf) - pos;
+
+    if (count < digits) data_.insert(data_.end(), std::min<std::size_t>(digits - count, 16), '0');
+
+    data_.insert(data_.end(), buf + pos, buf + sizeof(buf));
+}
+
+// shortest text that reads back to the same float
+void text_writer::write_float(float value)
+{
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    data_.insert(data_.end(), buf, res.ptr);
+}
+
+// double quoted with C escapes, other control characters as \ddd
+void text_writer::write_quoted(std::string_view text)
+{
+    this->write('"');
+
+    for (auto c : text)
+    {
+        switch (c)
+        {
+        case '"': this->write("\\\""); break;
+        case '\\': this->write("\\\\"); break;
+        case '\n': this->write("\\n"); break;
+        case '\r': this->write("\\r"); break;
+        case '\t': this->write("\\t"); break;
+        default:
+            if (static_cast<std::uint8_t>(c) < 0x20 || c == 0x7F)
+            {
+                this->write('\\');
+                this->write(char('0' + static_cast<std::uint8_t>(c) / 100));
+                this->write(char('0' + static_cast<std::uint8_t>(c) / 10 % 10));
+                this->write(char('0' + static_cast<std::uint8_t>(c) % 10));
+            }
+            else
+            {
+                this->write(c);
+            }
+            break;
+        }
+    }
+
+    this->write('"');
+}
+
+} // namespace utils
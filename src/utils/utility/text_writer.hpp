@@ -0,0 +1,36 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_TEXT_WRITER_HPP_
+#define _LUI_UTILS_TEXT_WRITER_HPP_
+
+namespace utils
+{
+
+// append-only text sink, formats numbers in place so emitting a line never
+// allocates once the storage has grown to fit the output.
+class text_writer
+{
+    std::vector<std::uint8_t> data_;
+
+public:
+    void reserve(std::size_t size);
+    void clear();
+    auto release() -> std::vector<std::uint8_t>;
+    auto size() -> std::size_t;
+
+    void write(char c);
+    void write(std::string_view text);
+    void write_padded(std::string_view text, std::size_t width);
+    void write_spaces(std::size_t count);
+    void write_int(std::int64_t value);
+    void write_hex(std::uint64_t value, std::size_t digits = 0);
+    void write_float(float value);
+    void write_quoted(std::string_view text);
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_TEXT_WRITER_HPP_
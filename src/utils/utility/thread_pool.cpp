@@ -0,0 +1,103 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#include "utils.hpp"
+
+namespace utils
+{
+
+thread_pool::thread_pool() : thread_pool(thread_pool::concurrency()) {}
+
+thread_pool::thread_pool(std::size_t count)
+{
+    count_ = (count == 0) ? 1 : count;
+
+    for (auto i = 0u; i < count_; i++)
+    {
+        queues_.push_back(std::make_unique<worker_queue>());
+    }
+}
+
+auto thread_pool::concurrency() -> std::size_t
+{
+    auto count = std::thread::hardware_concurrency();
+    return (count == 0) ? 1 : count;
+}
+
+void thread_pool::run(std::size_t task_count, const task& func)
+{
+    for (auto i = 0u; i < task_count; i++)
+    {
+        queues_.at(i % count_)->tasks.push_back(i);
+    }
+
+    if (count_ == 1)
+    {
+        this->work(0, func);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(count_ - 1);
+
+    for (auto i = 1u; i < count_; i++)
+    {
+        threads.emplace_back(&thread_pool::work, this, i, std::cref(func));
+    }
+
+    this->work(0, func);
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+auto thread_pool::size() -> std::size_t
+{
+    return count_;
+}
+
+void thread_pool::work(std::size_t worker, const task& func)
+{
+    std::size_t index;
+
+    while (this->pop(worker, index) || this->steal(worker, index))
+    {
+        func(worker, index);
+    }
+}
+
+auto thread_pool::pop(std::size_t worker, std::size_t& index) -> bool
+{
+    auto& queue = *queues_.at(worker);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) return false;
+
+    index = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+}
+
+auto thread_pool::steal(std::size_t worker, std::size_t& index) -> bool
+{
+    // tasks are never added while running, so one empty sweep means done
+    for (auto i = 1u; i < count_; i++)
+    {
+        auto& queue = *queues_.at((worker + i) % count_);
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty()) continue;
+
+        index = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace utils
@@ -0,0 +1,45 @@
+// Copyright 2020 xensik. All rights reserved.
+//
+// Use of this source code is governed by a GNU GPLv3 license
+// that can be found in the LICENSE file.
+
+#ifndef _LUI_UTILS_THREAD_POOL_HPP_
+#define _LUI_UTILS_THREAD_POOL_HPP_
+
+namespace utils
+{
+
+// work-stealing pool: tasks are dealt round-robin to per-worker queues in the
+// given order, each worker pops from the front of its own queue and steals
+// from the back of the others once it runs dry.
+class thread_pool
+{
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    std::size_t count_;
+    std::vector<std::unique_ptr<worker_queue>> queues_;
+
+public:
+    using task = std::function<void(std::size_t worker, std::size_t index)>;
+
+    thread_pool();
+    thread_pool(std::size_t count);
+
+    static auto concurrency() -> std::size_t;
+
+    void run(std::size_t task_count, const task& func);
+    auto size() -> std::size_t;
+
+private:
+    void work(std::size_t worker, const task& func);
+    auto pop(std::size_t worker, std::size_t& index) -> bool;
+    auto steal(std::size_t worker, std::size_t& index) -> bool;
+};
+
+} // namespace utils
+
+#endif // _LUI_UTILS_THREAD_POOL_HPP_
@@ -4,5 +4,3 @@
 // that can be found in the LICENSE file.
 
 #include "utils.hpp"
-
-std::uint32_t lui::node::indent = 0;
@@ -19,6 +19,8 @@
 #include <stack>
 #include <array>
 #include <vector>
+#include <deque>
+#include <list>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -26,9 +28,23 @@
 #include <memory>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <cstring>
+#include <cstddef>
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <tuple>
 #include <stdio.h>
 
 // Ext
@@ -39,10 +55,22 @@ using namespace std::literals;
 #include "utility/string.hpp"
 #include "utility/file.hpp"
 #include "utility/byte_buffer.hpp"
+#include "utility/byte_view.hpp"
+#include "utility/mapped_file.hpp"
+#include "utility/text_writer.hpp"
+#include "utility/string_pool.hpp"
+#include "utility/arena.hpp"
+#include "utility/thread_pool.hpp"
+#include "utility/search.hpp"
+#include "utility/bounded_queue.hpp"
+#include "utility/hash.hpp"
+#include "utility/cache.hpp"
 
 // LUI Types
 #include "types/nodetree.hpp"
 #include "types/assembly.hpp"
+#include "types/printer.hpp"
+#include "types/image.hpp"
 
 // LUI Interfaces
 #include "interfaces/assembler.hpp"